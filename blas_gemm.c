@@ -0,0 +1,380 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+ * This software was developed as part of the
+ * EC FP7 funded project Adept (Project ID: 610490)
+ * www.adept-project.eu
+ */
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * UPC BLAS benchmark - dense matrix-matrix multiplication (SUMMA)
+ *
+ * C = A * B for square n x n matrices distributed in 2D blocks over a
+ * P x Q grid of threads: thread pi*Q + pj owns rows [pi*mb, (pi+1)*mb)
+ * and columns [pj*nb, (pj+1)*nb) of all three.  For each panel of kb
+ * columns of A and kb rows of B, every thread fetches the piece of the A
+ * panel in its block row and the piece of the B panel in its block
+ * column with one one-sided get each, and adds their product into its
+ * block of C.  A blocks are stored by columns and B and C blocks by rows,
+ * so that every piece of a panel is contiguous in its owner's memory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <upc.h>
+
+#include "level1.h"
+#include "utils.h"
+
+/* widest panel */
+#define GEMM_PANEL 64
+
+/* columns of C per cache block of the local multiply */
+#define GEMM_NC 256
+
+/* Pointer to the start of one thread's block, addressed in bytes */
+typedef shared [] char *gemm_ptr;
+
+/* 2D block distribution of the three matrices */
+typedef struct {
+  int n;          /* rows and columns of the matrices */
+  int p, q;       /* threads along the rows and the columns of the grid */
+  int pi, pj;     /* coordinates of MYTHREAD in the grid */
+  int mb, nb;     /* rows and columns of every block */
+  int kb;         /* panel width */
+  size_t elem;    /* bytes per element */
+} gemm_t;
+
+static int gemm_gcd(int a, int b){
+
+  int t;
+
+  while (b != 0) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+
+  return a;
+}
+
+/*
+ * Set up the thread grid, "PxQ" or, given NULL, the most nearly square
+ * factorisation of THREADS, and the block and panel sizes.  The matrix
+ * size is rounded down so that both P and Q divide it.  Returns -1 if
+ * no such grid fits.
+ */
+static int gemm_init(gemm_t *g, unsigned int size, const char *spec, size_t elem){
+
+  int l, d, end = 0;
+
+  if (spec != NULL) {
+    if (sscanf(spec, "%dx%d%n", &g->p, &g->q, &end) != 2 || spec[end] != '\0') return -1;
+    if (g->p < 1 || g->q < 1 || g->p*g->q != THREADS) return -1;
+  }
+  else {
+    for (g->p = 1, d = 1; d*d <= THREADS; d++) {
+      if (THREADS % d == 0) g->p = d;
+    }
+    g->q = THREADS / g->p;
+  }
+
+  l = g->p / gemm_gcd(g->p, g->q) * g->q;
+  g->n = (size / l) * l;
+  if (g->n == 0) return -1;
+
+  g->pi = MYTHREAD / g->q;
+  g->pj = MYTHREAD % g->q;
+  g->mb = g->n / g->p;
+  g->nb = g->n / g->q;
+  g->elem = elem;
+
+  /* a panel must lie within one block column of A and one block row of B */
+  d = gemm_gcd(g->mb, g->nb);
+  for (g->kb = (d < GEMM_PANEL) ? d : GEMM_PANEL; d % g->kb != 0; g->kb--);
+
+  return 0;
+}
+
+/* Element of the input matrix s at row i, column j, from the counter-based generator */
+static double gemm_value(int s, const gemm_t *g, int i, int j){
+  return 2.0*counter_uniform(((unsigned long long)s << 48) ^ ((unsigned long long)i*g->n + j)) - 1.0;
+}
+
+/*
+ * c += a*b for an mb x kb piece of an A panel, stored by columns, and a
+ * kb x nb piece of a B panel, stored by rows.  C is taken GEMM_NC
+ * columns at a time so that four of its rows stay in cache while the
+ * panel of B streams past them; each element of A is loaded once into a
+ * register per four rows, and the inner loop is unit stride in B and C so
+ * that the compiler can vectorise it.
+ */
+static void gemm_local_double(const double *a, const double *b, double *c, int mb, int nb, int kb){
+
+  int i, j, p, jb, je;
+  const double *bp;
+  double *c0, *c1, *c2, *c3;
+  double a0, a1, a2, a3;
+
+  for (jb = 0; jb < nb; jb += GEMM_NC) {
+    je = (jb + GEMM_NC < nb) ? jb + GEMM_NC : nb;
+
+    for (i = 0; i+3 < mb; i += 4) {
+      c0 = c + (size_t)i*nb;
+      c1 = c0 + nb;
+      c2 = c1 + nb;
+      c3 = c2 + nb;
+      for (p = 0; p < kb; p++) {
+	a0 = a[(size_t)p*mb + i];
+	a1 = a[(size_t)p*mb + i+1];
+	a2 = a[(size_t)p*mb + i+2];
+	a3 = a[(size_t)p*mb + i+3];
+	bp = b + (size_t)p*nb;
+	for (j = jb; j < je; j++) {
+	  c0[j] += a0 * bp[j];
+	  c1[j] += a1 * bp[j];
+	  c2[j] += a2 * bp[j];
+	  c3[j] += a3 * bp[j];
+	}
+      }
+    }
+    for (; i < mb; i++) {
+      c0 = c + (size_t)i*nb;
+      for (p = 0; p < kb; p++) {
+	a0 = a[(size_t)p*mb + i];
+	bp = b + (size_t)p*nb;
+	for (j = jb; j < je; j++) {
+	  c0[j] += a0 * bp[j];
+	}
+      }
+    }
+  }
+}
+
+static void gemm_local_float(const float *a, const float *b, float *c, int mb, int nb, int kb){
+
+  int i, j, p, jb, je;
+  const float *bp;
+  float *c0, *c1, *c2, *c3;
+  float a0, a1, a2, a3;
+
+  for (jb = 0; jb < nb; jb += GEMM_NC) {
+    je = (jb + GEMM_NC < nb) ? jb + GEMM_NC : nb;
+
+    for (i = 0; i+3 < mb; i += 4) {
+      c0 = c + (size_t)i*nb;
+      c1 = c0 + nb;
+      c2 = c1 + nb;
+      c3 = c2 + nb;
+      for (p = 0; p < kb; p++) {
+	a0 = a[(size_t)p*mb + i];
+	a1 = a[(size_t)p*mb + i+1];
+	a2 = a[(size_t)p*mb + i+2];
+	a3 = a[(size_t)p*mb + i+3];
+	bp = b + (size_t)p*nb;
+	for (j = jb; j < je; j++) {
+	  c0[j] += a0 * bp[j];
+	  c1[j] += a1 * bp[j];
+	  c2[j] += a2 * bp[j];
+	  c3[j] += a3 * bp[j];
+	}
+      }
+    }
+    for (; i < mb; i++) {
+      c0 = c + (size_t)i*nb;
+      for (p = 0; p < kb; p++) {
+	a0 = a[(size_t)p*mb + i];
+	bp = b + (size_t)p*nb;
+	for (j = jb; j < je; j++) {
+	  c0[j] += a0 * bp[j];
+	}
+      }
+    }
+  }
+}
+
+/* Store v as element k of a private block of doubles or floats */
+static void gemm_set(const gemm_t *g, void *block, size_t k, double v){
+
+  if (g->elem == sizeof(double)) ((double *)block)[k] = v;
+  else ((float *)block)[k] = (float)v;
+}
+
+/* Free the blocks, their directories and the panel buffers.  Collective. */
+static void gemm_free(shared gemm_ptr *adir, shared gemm_ptr *bdir, shared gemm_ptr *cdir,
+		      shared double *tcomm, shared double *tcomp, void *ap, void *bp){
+
+  free(ap);
+  free(bp);
+
+  upc_barrier;
+
+  upc_free(adir[MYTHREAD]);
+  upc_free(bdir[MYTHREAD]);
+  upc_free(cdir[MYTHREAD]);
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) {
+    upc_free(adir);
+    upc_free(bdir);
+    upc_free(cdir);
+    upc_free(tcomm);
+    upc_free(tcomp);
+  }
+}
+
+static void gemm_run(unsigned int size, bench_opts *opts, size_t elem, char *title){
+
+  gemm_t g;
+  int i, j, k, t, fail;
+  size_t block;
+  void *la, *lb, *lc, *ap, *bp;
+  double comm = 0.0, comp = 0.0, total, expect, got;
+  shared gemm_ptr *adir, *bdir, *cdir;
+  shared double *tcomm, *tcomp;
+
+  struct timespec start, end, t0, t1, t2;
+
+  if (gemm_init(&g, size, opts->pgrid, elem) != 0) {
+    if (MYTHREAD == 0) printf("GEMM Error: no valid thread grid for %d threads on %d x %d matrices\n", THREADS, size, size);
+    return;
+  }
+
+  block = (size_t)g.mb*g.nb*g.elem;
+
+  adir = (shared gemm_ptr *)upc_all_alloc(THREADS, sizeof(gemm_ptr));
+  bdir = (shared gemm_ptr *)upc_all_alloc(THREADS, sizeof(gemm_ptr));
+  cdir = (shared gemm_ptr *)upc_all_alloc(THREADS, sizeof(gemm_ptr));
+  tcomm = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+  tcomp = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  adir[MYTHREAD] = (gemm_ptr)upc_alloc(block);
+  bdir[MYTHREAD] = (gemm_ptr)upc_alloc(block);
+  cdir[MYTHREAD] = (gemm_ptr)upc_alloc(block);
+  ap = malloc((size_t)g.mb*g.kb*g.elem);
+  bp = malloc((size_t)g.kb*g.nb*g.elem);
+
+  upc_barrier;
+
+  fail = (ap == NULL || bp == NULL);
+  for (t = 0; t < THREADS; t++) {
+    if (adir[t] == NULL || bdir[t] == NULL || cdir[t] == NULL) fail = 1;
+  }
+
+  if (any_thread(fail)) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("GEMM Error: Unable to allocate memory\n");
+    gemm_free(adir, bdir, cdir, tcomm, tcomp, ap, bp);
+    return;
+  }
+
+  if (MYTHREAD == 0) printf("Matrices of %d x %d on a %d x %d thread grid, blocks of %d x %d, panels of %d\n", g.n, g.n, g.p, g.q, g.mb, g.nb, g.kb);
+
+  la = (void *)adir[MYTHREAD];
+  lb = (void *)bdir[MYTHREAD];
+  lc = (void *)cdir[MYTHREAD];
+
+  /* fill A by columns and B by rows, each thread its own block, and clear C */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  for (i = 0; i < g.mb; i++) {
+    for (j = 0; j < g.nb; j++) {
+      gemm_set(&g, la, (size_t)j*g.mb + i, gemm_value(1, &g, g.pi*g.mb + i, g.pj*g.nb + j));
+      gemm_set(&g, lb, (size_t)i*g.nb + j, gemm_value(2, &g, g.pi*g.mb + i, g.pj*g.nb + j));
+    }
+  }
+  memset(lc, 0, block);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  for (k = 0; k < g.n; k += g.kb) {
+
+    clock_gettime(CLOCK, &t0);
+
+    /* the piece of the A panel in this block row, and of the B panel in this block column */
+    upc_memget(ap, adir[g.pi*g.q + k/g.nb] + (size_t)(k % g.nb)*g.mb*g.elem, (size_t)g.mb*g.kb*g.elem);
+    upc_memget(bp, bdir[(k/g.mb)*g.q + g.pj] + (size_t)(k % g.mb)*g.nb*g.elem, (size_t)g.kb*g.nb*g.elem);
+
+    clock_gettime(CLOCK, &t1);
+
+    if (g.elem == sizeof(double)) gemm_local_double(ap, bp, lc, g.mb, g.nb, g.kb);
+    else gemm_local_float(ap, bp, lc, g.mb, g.nb, g.kb);
+
+    clock_gettime(CLOCK, &t2);
+
+    comm += elapsed_seconds(t0, t1);
+    comp += elapsed_seconds(t1, t2);
+  }
+
+  tcomm[MYTHREAD] = comm;
+  tcomp[MYTHREAD] = comp;
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  if (MYTHREAD == 0) {
+    total = elapsed_seconds(start, end);
+
+    /* mean time per thread in the panel fetches and in the local multiplies */
+    comm = comp = 0.0;
+    for (t = 0; t < THREADS; t++) {
+      comm += tcomm[t] / THREADS;
+      comp += tcomp[t] / THREADS;
+    }
+
+    elapsed_time_hr(start, end, title);
+    printf("GFLOP/s: %.3lf   Local GEMM GFLOP/s per thread: %.3lf\n",
+	   2.0*g.n*g.n*g.n / total * 1.0e-9, 2.0*g.mb*g.nb*g.n / comp * 1.0e-9);
+    printf("Panel fetch: %.9lf s   Local multiply: %.9lf s   Communication share: %.1lf%%\n",
+	   comm, comp, 100.0*comm / (comm + comp));
+
+    /* check one element against a product computed here from the generator */
+    expect = 0.0;
+    for (k = 0; k < g.n; k++) {
+      if (g.elem == sizeof(double)) expect += gemm_value(1, &g, 0, k) * gemm_value(2, &g, k, 0);
+      else expect += (double)(float)gemm_value(1, &g, 0, k) * (float)gemm_value(2, &g, k, 0);
+    }
+    got = (g.elem == sizeof(double)) ? ((double *)lc)[0] : ((float *)lc)[0];
+    printf("Result C[0][0] = %f (expected %f)\n", got, expect);
+  }
+
+  gemm_free(adir, bdir, cdir, tcomm, tcomp, ap, bp);
+}
+
+/* C = A * B on n x n matrices of doubles */
+int double_gemm(unsigned int size, bench_opts *opts){
+
+  gemm_run(size, opts, sizeof(double), "Double GEMM (SUMMA).");
+  return 0;
+}
+
+/* C = A * B on n x n matrices of floats */
+int float_gemm(unsigned int size, bench_opts *opts){
+
+  gemm_run(size, opts, sizeof(float), "Float GEMM (SUMMA).");
+  return 0;
+}
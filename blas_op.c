@@ -27,12 +27,148 @@
 #include <limits.h>
 
 #include <upc.h>
+#ifdef __UPC_COLLECTIVE__
+#include <upc_collective.h>
+#endif
 
 #include "level1.h"
 #include "utils.h"
 #include "matrix_utils.h"
 
 
+/*
+ * totals of the reductions, with affinity to thread 0
+ *
+ * The private variants of the dot products and norms keep four independent
+ * partial sums, so consecutive adds do not wait on each other.
+ */
+static shared int total_int;
+static shared float total_float;
+static shared double total_double;
+
+/*
+ * Sum of one partial per thread, valid on thread 0.  The partials are
+ * combined pairwise in log2(THREADS) rounds, in each of which every
+ * thread still taking part adds in the partial of the one stride above
+ * it, or by upc_all_reduce where the UPC collectives library is
+ * available.  Collective; the partials must have been written before a
+ * barrier, and are overwritten.
+ */
+static int reduce_int(shared int *part){
+
+#ifdef __UPC_COLLECTIVE__
+  upc_all_reduceI(&total_int, part, UPC_ADD, THREADS, 1, NULL, UPC_IN_NOSYNC | UPC_OUT_ALLSYNC);
+#else
+  int stride;
+
+  for (stride = 1; stride < THREADS; stride *= 2) {
+    if (MYTHREAD % (2*stride) == 0 && MYTHREAD + stride < THREADS) {
+      part[MYTHREAD] = part[MYTHREAD] + part[MYTHREAD + stride];
+    }
+    upc_barrier;
+  }
+
+  if (MYTHREAD == 0) total_int = part[0];
+#endif
+
+  return (MYTHREAD == 0) ? total_int : 0;
+}
+
+static float reduce_float(shared float *part){
+
+#ifdef __UPC_COLLECTIVE__
+  upc_all_reduceF(&total_float, part, UPC_ADD, THREADS, 1, NULL, UPC_IN_NOSYNC | UPC_OUT_ALLSYNC);
+#else
+  int stride;
+
+  for (stride = 1; stride < THREADS; stride *= 2) {
+    if (MYTHREAD % (2*stride) == 0 && MYTHREAD + stride < THREADS) {
+      part[MYTHREAD] = part[MYTHREAD] + part[MYTHREAD + stride];
+    }
+    upc_barrier;
+  }
+
+  if (MYTHREAD == 0) total_float = part[0];
+#endif
+
+  return (MYTHREAD == 0) ? total_float : 0.0;
+}
+
+static double reduce_double(shared double *part){
+
+#ifdef __UPC_COLLECTIVE__
+  upc_all_reduceD(&total_double, part, UPC_ADD, THREADS, 1, NULL, UPC_IN_NOSYNC | UPC_OUT_ALLSYNC);
+#else
+  int stride;
+
+  for (stride = 1; stride < THREADS; stride *= 2) {
+    if (MYTHREAD % (2*stride) == 0 && MYTHREAD + stride < THREADS) {
+      part[MYTHREAD] = part[MYTHREAD] + part[MYTHREAD + stride];
+    }
+    upc_barrier;
+  }
+
+  if (MYTHREAD == 0) total_double = part[0];
+#endif
+
+  return (MYTHREAD == 0) ? total_double : 0.0;
+}
+
+/*
+ * Counter-based random inputs.  Element i of stream s takes a value that
+ * depends only on s and i, so every thread fills its own elements of a
+ * cyclic array through a private pointer, with no remote writes, and the
+ * inputs are the same for any number of threads.  Ints lie in
+ * [-RAND_INT, RAND_INT), so that the sums of products and of squares in
+ * the int kernels cannot overflow below 2^25 elements, floats in [0, 1)
+ * and doubles in [-1, 1).
+ */
+#define RAND_KEY(s, i) (((unsigned long long)(s) << 48) ^ (unsigned long long)(i))
+#define RAND_INT 8
+
+static int rand_int(int s, unsigned long i){
+  return (int)(splitmix64(RAND_KEY(s, i)) % (2*RAND_INT)) - RAND_INT;
+}
+
+static float rand_float(int s, unsigned long i){
+  return (float)counter_uniform(RAND_KEY(s, i));
+}
+
+static double rand_double(int s, unsigned long i){
+  return 2.0*counter_uniform(RAND_KEY(s, i)) - 1.0;
+}
+
+/* Fill the n elements of v, a multiple of THREADS, from stream s */
+static void fill_int(shared int *v, unsigned long n, int s){
+
+  int *l = (int *)&v[MYTHREAD];
+  unsigned long k;
+
+  for(k=0; k<n/THREADS; k++){
+    l[k] = rand_int(s, k*THREADS + MYTHREAD);
+  }
+}
+
+static void fill_float(shared float *v, unsigned long n, int s){
+
+  float *l = (float *)&v[MYTHREAD];
+  unsigned long k;
+
+  for(k=0; k<n/THREADS; k++){
+    l[k] = rand_float(s, k*THREADS + MYTHREAD);
+  }
+}
+
+static void fill_double(shared double *v, unsigned long n, int s){
+
+  double *l = (double *)&v[MYTHREAD];
+  unsigned long k;
+
+  for(k=0; k<n/THREADS; k++){
+    l[k] = rand_double(s, k*THREADS + MYTHREAD);
+  }
+}
+
 /*
  * Vector dot product, integers
  *
@@ -42,7 +178,7 @@
  * Output: dot product
  *
  */
-int int_dot_product(unsigned int size){
+int int_dot_product(unsigned int size, bench_opts *opts){
 
   int i;
   int local_size = size / THREADS;
@@ -60,49 +196,116 @@ int int_dot_product(unsigned int size){
     return 0;
   }
 
-  struct timespec start, end;
+  struct timespec start, mid, end;
+  double t_shared = 0.0, t_private = 0.0;
+  int *l1, *l2;
+  int sum, s0, s1, s2, s3;
 
   tmp_result[MYTHREAD] = 0;
 
-  /* fill vectors with random integer values */
-  if(MYTHREAD == 0){
-    for(i=0; i<local_size*THREADS; i++){
-      v1[i] = KISS;
-      v2[i] = KISS;
-    }
-  }
+  /* fill the vectors with random ints, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_int(v1, local_size*THREADS, 1);
+  fill_int(v2, local_size*THREADS, 2);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
  
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size*THREADS);
   upc_barrier_timer();
 
-  upc_barrier;
+  if (RUN_SHARED(opts)){
 
-  clock_gettime(CLOCK, &start);
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
 
-  /* perform dot product */
+    /* perform dot product */
 
-  upc_forall(i=0; i<local_size*THREADS; i++; &v1[i]){
-    tmp_result[MYTHREAD] = tmp_result[MYTHREAD] + v1[i] * v2[i];
-  }
+    sum = 0;
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(int) b1 = BLOCK_OF(int, v1);
+      BLOCK_PTR(int) b2 = BLOCK_OF(int, v2);
+      for(i=0; i<local_size; i++){
+        sum = sum + b1[i] * b2[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &v1[i]){
+        sum = sum + v1[i] * v2[i];
+      }
+    }
+    tmp_result[MYTHREAD] = sum;
 
-  upc_barrier;
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
 
-  if (MYTHREAD==0){
-    for(i=0;i<THREADS;i++){
-      result = result + tmp_result[i];
+    sum = reduce_int((shared int *)tmp_result);
+    if (MYTHREAD==0) result = sum;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Dot product result: %d\n", result);
+
+      elapsed_time_hr(start, end, "Integer dot product.");
+      reduction_summary(start, mid, end);
     }
+
+    t_shared = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
-  clock_gettime(CLOCK, &end);
+  if (RUN_PRIVATE(opts)){
 
-  if (MYTHREAD==0){
+    /* this thread's elements of v1 and v2 are contiguous in its local memory */
+    l1 = (int *)&v1[MYTHREAD];
+    l2 = (int *)&v2[MYTHREAD];
 
-    /* print result so compiler does not throw it away */
-    printf("Dot product result: %d\n", result);
+    tmp_result[MYTHREAD] = 0;
+    if (MYTHREAD==0) result = 0;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform dot product on private pointers */
+    s0 = s1 = s2 = s3 = 0;
+    for(i=0; i+3<local_size; i+=4){
+      s0 = s0 + l1[i] * l2[i];
+      s1 = s1 + l1[i+1] * l2[i+1];
+      s2 = s2 + l1[i+2] * l2[i+2];
+      s3 = s3 + l1[i+3] * l2[i+3];
+    }
+    for(; i<local_size; i++){
+      s0 = s0 + l1[i] * l2[i];
+    }
+    tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    sum = reduce_int((shared int *)tmp_result);
+    if (MYTHREAD==0) result = sum;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Dot product result: %d\n", result);
+
+      elapsed_time_hr(start, end, "Integer dot product (private).");
+      reduction_summary(start, mid, end);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
 
-    elapsed_time_hr(start, end, "Integer dot product.");
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Integer dot product.", t_shared, t_private);
 
     upc_free(v1);
     upc_free(v2);
@@ -121,7 +324,7 @@ int int_dot_product(unsigned int size){
  * Output: dot product
  *
  */
-int float_dot_product(unsigned int size){
+int float_dot_product(unsigned int size, bench_opts *opts){
 
   int i;
   int local_size = size / THREADS;
@@ -139,43 +342,121 @@ int float_dot_product(unsigned int size){
     return 0;
   }
 
-  struct timespec start, end;
+  struct timespec start, mid, end;
+  double t_shared = 0.0, t_private = 0.0;
+  float *l1, *l2;
+  float sum, s0, s1, s2, s3;
 
   tmp_result[MYTHREAD] = 0.0;
 
-  /* fill vectors with random floats */
-  if(MYTHREAD == 0){
-    for(i=0; i<local_size*THREADS; i++){
-      v1[i] = UNI;
-      v2[i] = UNI;
-    }
-  }
+  /* fill the vectors with random floats, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_float(v1, local_size*THREADS, 1);
+  fill_float(v2, local_size*THREADS, 2);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size*THREADS);
   upc_barrier_timer();
-  upc_barrier;
 
-  clock_gettime(CLOCK, &start);
+  if (RUN_SHARED(opts)){
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform dot product */
+
+    sum = 0.0;
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(float) b1 = BLOCK_OF(float, v1);
+      BLOCK_PTR(float) b2 = BLOCK_OF(float, v2);
+      for(i=0; i<local_size; i++){
+        sum = sum + b1[i] * b2[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &v1[i]){
+        sum = sum + v1[i] * v2[i];
+      }
+    }
+    tmp_result[MYTHREAD] = sum;
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    sum = reduce_float(tmp_result);
+    if (MYTHREAD==0) result = sum;
+
+    clock_gettime(CLOCK, &end);
 
-  /* perform dot product */
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Dot product result: %f\n", result);
 
-  upc_forall(i=0; i<local_size*THREADS; i++; &v1[i]){
-    tmp_result[MYTHREAD] = tmp_result[MYTHREAD] + v1[i] * v2[i];
+      elapsed_time_hr(start, end, "Float dot product.");
+      reduction_summary(start, mid, end);
+    }
+
+    t_shared = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
-  clock_gettime(CLOCK, &end);
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of v1 and v2 are contiguous in its local memory */
+    l1 = (float *)&v1[MYTHREAD];
+    l2 = (float *)&v2[MYTHREAD];
+
+    tmp_result[MYTHREAD] = 0.0;
+    if (MYTHREAD==0) result = 0.0;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform dot product on private pointers */
+    s0 = s1 = s2 = s3 = 0.0;
+    for(i=0; i+3<local_size; i+=4){
+      s0 = s0 + l1[i] * l2[i];
+      s1 = s1 + l1[i+1] * l2[i+1];
+      s2 = s2 + l1[i+2] * l2[i+2];
+      s3 = s3 + l1[i+3] * l2[i+3];
+    }
+    for(; i<local_size; i++){
+      s0 = s0 + l1[i] * l2[i];
+    }
+    tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    sum = reduce_float(tmp_result);
+    if (MYTHREAD==0) result = sum;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Dot product result: %f\n", result);
+
+      elapsed_time_hr(start, end, "Float dot product (private).");
+      reduction_summary(start, mid, end);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
 
   if (MYTHREAD==0){
-	/* print result so compiler does not throw it away */
-	printf("Dot product result: %f\n", result);
 
-	elapsed_time_hr(start, end, "Float dot product.");
+    if (RUN_BOTH(opts)) variant_summary("Float dot product.", t_shared, t_private);
 
-	upc_free(v1);
-	upc_free(v2);
+    upc_free(v1);
+    upc_free(v2);
   }
+
   return 0;
 
 }
@@ -190,7 +471,7 @@ int float_dot_product(unsigned int size){
  * Output: dot product
  *
  */
-int double_dot_product(unsigned int size){
+int double_dot_product(unsigned int size, bench_opts *opts){
 
   int i;
   int local_size = size / THREADS;
@@ -208,44 +489,121 @@ int double_dot_product(unsigned int size){
     return 0;
   }
 
-  struct timespec start, end;
+  struct timespec start, mid, end;
+  double t_shared = 0.0, t_private = 0.0;
+  double *l1, *l2;
+  double sum, s0, s1, s2, s3;
 
   tmp_result[MYTHREAD] = 0.0;
 
-  /* fill vectors with random doubles */
-  if(MYTHREAD == 0){
-    for(i=0; i<local_size*THREADS; i++){
-      v1[i] = VNI;
-      v2[i] = VNI;
-    }
-  }
+  /* fill the vectors with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(v1, local_size*THREADS, 1);
+  fill_double(v2, local_size*THREADS, 2);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
   
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size*THREADS);
   upc_barrier_timer();
 
-  upc_barrier;
+  if (RUN_SHARED(opts)){
 
-  clock_gettime(CLOCK, &start);
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform dot product */
+
+    sum = 0.0;
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(double) b1 = BLOCK_OF(double, v1);
+      BLOCK_PTR(double) b2 = BLOCK_OF(double, v2);
+      for(i=0; i<local_size; i++){
+        sum = sum + b1[i] * b2[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &v1[i]){
+        sum = sum + v1[i] * v2[i];
+      }
+    }
+    tmp_result[MYTHREAD] = sum;
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    sum = reduce_double(tmp_result);
+    if (MYTHREAD==0) result = sum;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Dot product result: %f\n", result);
 
-  /* perform dot product */
+      elapsed_time_hr(start, end, "Double dot product.");
+      reduction_summary(start, mid, end);
+    }
 
-  upc_forall(i=0; i<local_size*THREADS; i++; &v1[i]){
-    tmp_result[MYTHREAD] = tmp_result[MYTHREAD] + v1[i] * v2[i];
+    t_shared = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
-  clock_gettime(CLOCK, &end);
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of v1 and v2 are contiguous in its local memory */
+    l1 = (double *)&v1[MYTHREAD];
+    l2 = (double *)&v2[MYTHREAD];
+
+    tmp_result[MYTHREAD] = 0.0;
+    if (MYTHREAD==0) result = 0.0;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform dot product on private pointers */
+    s0 = s1 = s2 = s3 = 0.0;
+    for(i=0; i+3<local_size; i+=4){
+      s0 = s0 + l1[i] * l2[i];
+      s1 = s1 + l1[i+1] * l2[i+1];
+      s2 = s2 + l1[i+2] * l2[i+2];
+      s3 = s3 + l1[i+3] * l2[i+3];
+    }
+    for(; i<local_size; i++){
+      s0 = s0 + l1[i] * l2[i];
+    }
+    tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    sum = reduce_double(tmp_result);
+    if (MYTHREAD==0) result = sum;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Dot product result: %f\n", result);
+
+      elapsed_time_hr(start, end, "Double dot product (private).");
+      reduction_summary(start, mid, end);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
 
   if (MYTHREAD==0){
-    /* print result so compiler does not throw it away */
-	printf("Dot product result: %f\n", result);
 
-    elapsed_time_hr(start, end, "Double dot product.");
+    if (RUN_BOTH(opts)) variant_summary("Double dot product.", t_shared, t_private);
 
     upc_free(v1);
     upc_free(v2);
   }
+
   return 0;
 
 }
@@ -253,7 +611,7 @@ int double_dot_product(unsigned int size){
 
 /* Vector scalar multiplication, integers    */
 /* v_i = a * v1_i                     */
-int int_scalar_mult(unsigned int size){
+int int_scalar_mult(unsigned int size, bench_opts *opts){
 
   int i;
   int local_size = size/THREADS;
@@ -268,99 +626,89 @@ int int_scalar_mult(unsigned int size){
   }
 
   struct timespec start, end;
+  double t_shared = 0.0, t_private = 0.0;
+  int *lv;
+  int la;
 
-  /* fill vector with random ints */
-  if(MYTHREAD == 0){
-    for(i=0; i<local_size*THREADS; i++){
-      v[i] = KISS;
-    }
-
-    /* assign random int value */
-    a = KISS;
-  }
+  /* fill the vector and scalar with random ints, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_int(v, local_size*THREADS, 1);
+  if (MYTHREAD == 0) a = rand_int(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
   
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
   upc_barrier_timer();
 
-  upc_barrier;
+  if (RUN_SHARED(opts)){
 
-  clock_gettime(CLOCK, &start);
+    upc_barrier;
 
-  /* perform scalar product */
-  upc_forall(i=0; i<local_size*THREADS; i++; &v[i]){
-    v[i] = a * v[i];
-  }
-  
-  upc_barrier;
+    clock_gettime(CLOCK, &start);
 
-  clock_gettime(CLOCK, &end);
+    /* perform scalar product */
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(int) bv = BLOCK_OF(int, v);
+      for(i=0; i<local_size; i++){
+        bv[i] = a * bv[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &v[i]){
+        v[i] = a * v[i];
+      }
+    }
 
-  if(MYTHREAD == 0){
-    /* print result so compiler does not throw it away */
-    printf("Scalar product result: %d\n", v[0]);
-    
-    elapsed_time_hr(start, end, "Int scalar multiplication.");
-    
-    upc_free(v);
-  }
+    upc_barrier;
 
-  return 0;
+    clock_gettime(CLOCK, &end);
 
-}
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Scalar product result: %d\n", v[0]);
 
-/* Vector scalar multiplication, floats    */
-/* v_i = a * v1_i                     */
-int float_scalar_mult(unsigned int size){
+      elapsed_time_hr(start, end, "Int scalar multiplication.");
+    }
 
-  int i;
-  int local_size = size/THREADS;
+    t_shared = elapsed_seconds(start, end);
+  }
 
-  /* create vector and scalar */
-  shared float *v = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
-  static shared float a = 0.0;
+  if (RUN_PRIVATE(opts)){
 
-  if(v == NULL){
-    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the array.\n");
-    return 0;
-  }
+    /* this thread's elements of v are contiguous in its local memory */
+    lv = (int *)&v[MYTHREAD];
+    la = a;
 
-  struct timespec start, end;
+    upc_barrier;
 
-  /* fill vector with random floats */
-  if (MYTHREAD == 0){
-    for(i=0; i<size; i++){
-      v[i] = UNI;
-    }  
+    clock_gettime(CLOCK, &start);
 
-    /* assign random float value */
-    a = UNI;
+    /* perform scalar product on private pointers */
+    for(i=0; i<local_size; i++){
+      lv[i] = la * lv[i];
+    }
 
-  }
+    upc_barrier;
 
-  /* measuring upc_forall and upc_barrier overheads */
-  upc_loop_timer_nop(local_size);
-  upc_barrier_timer();
+    clock_gettime(CLOCK, &end);
 
-  upc_barrier;
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Scalar product result: %d\n", v[0]);
 
-  clock_gettime(CLOCK, &start);
+      elapsed_time_hr(start, end, "Int scalar multiplication (private).");
+    }
 
-  /* perfom scalar product */
-  upc_forall(i=0; i<local_size*THREADS; i++; &v[i]){
-    v[i] = a * v[i];
+    t_private = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
+  if (MYTHREAD==0){
 
-  clock_gettime(CLOCK, &end);
+    if (RUN_BOTH(opts)) variant_summary("Int scalar multiplication.", t_shared, t_private);
 
-  if (MYTHREAD == 0){
-    /* print result so compiler does not throw it away */
-    printf("Scalar product result: %f\n", v[0]);
-    
-    elapsed_time_hr(start, end, "Float scalar multiplication.");
-    
     upc_free(v);
   }
 
@@ -368,16 +716,16 @@ int float_scalar_mult(unsigned int size){
 
 }
 
-/* Vector scalar multiplication, doubles    */
+/* Vector scalar multiplication, floats    */
 /* v_i = a * v1_i                     */
-int double_scalar_mult(unsigned int size){
+int float_scalar_mult(unsigned int size, bench_opts *opts){
 
   int i;
-  int local_size = size / THREADS;
+  int local_size = size/THREADS;
 
   /* create vector and scalar */
-  shared double *v = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
-  static shared double a = 0.0;
+  shared float *v = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
+  static shared float a = 0.0;
 
   if(v == NULL){
     if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the array.\n");
@@ -385,42 +733,199 @@ int double_scalar_mult(unsigned int size){
   }
 
   struct timespec start, end;
+  double t_shared = 0.0, t_private = 0.0;
+  float *lv;
+  float la;
 
-  if (MYTHREAD==0){
-    /* fill vector with random doubles */
-    for(i=0; i<local_size*THREADS; i++){
-      v[i] = VNI;
-    }
-    
-    /* assign random double value */
-    a = VNI;
+  /* fill the vector and scalar with random floats, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_float(v, local_size*THREADS, 1);
+  if (MYTHREAD == 0) a = rand_float(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* measuring upc_forall and upc_barrier overheads */
+  upc_loop_timer_nop(local_size);
+  upc_barrier_timer();
+
+  if (RUN_SHARED(opts)){
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform scalar product */
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(float) bv = BLOCK_OF(float, v);
+      for(i=0; i<local_size; i++){
+        bv[i] = a * bv[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &v[i]){
+        v[i] = a * v[i];
+      }
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Scalar product result: %f\n", v[0]);
+
+      elapsed_time_hr(start, end, "Float scalar multiplication.");
+    }
+
+    t_shared = elapsed_seconds(start, end);
+  }
+
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of v are contiguous in its local memory */
+    lv = (float *)&v[MYTHREAD];
+    la = a;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform scalar product on private pointers */
+    for(i=0; i<local_size; i++){
+      lv[i] = la * lv[i];
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Scalar product result: %f\n", v[0]);
+
+      elapsed_time_hr(start, end, "Float scalar multiplication (private).");
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
+
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Float scalar multiplication.", t_shared, t_private);
+
+    upc_free(v);
+  }
+
+  return 0;
+
+}
+
+/* Vector scalar multiplication, doubles    */
+/* v_i = a * v1_i                     */
+int double_scalar_mult(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  /* create vector and scalar */
+  shared double *v = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  static shared double a = 0.0;
+
+  if(v == NULL){
+    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the array.\n");
+    return 0;
   }
+
+  struct timespec start, end;
+  double t_shared = 0.0, t_private = 0.0;
+  double *lv;
+  double la;
+
+  /* fill the vector and scalar with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(v, local_size*THREADS, 1);
+  if (MYTHREAD == 0) a = rand_double(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
   
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
   upc_barrier_timer();
 
-  upc_barrier;
+  if (RUN_SHARED(opts)){
 
-  clock_gettime(CLOCK, &start);
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform scalar product */
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(double) bv = BLOCK_OF(double, v);
+      for(i=0; i<local_size; i++){
+        bv[i] = a * bv[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &v[i]){
+        v[i] = a * v[i];
+      }
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
 
-  /* perform scalar product */
-  upc_forall(i=0; i<local_size*THREADS; i++; &v[i]){
-    v[i] = a * v[i];
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Scalar product result: %f\n", v[0]);
+
+      elapsed_time_hr(start, end, "Double scalar multiplication.");
+    }
+
+    t_shared = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
+  if (RUN_PRIVATE(opts)){
 
-  clock_gettime(CLOCK, &end);
+    /* this thread's elements of v are contiguous in its local memory */
+    lv = (double *)&v[MYTHREAD];
+    la = a;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* perform scalar product on private pointers */
+    for(i=0; i<local_size; i++){
+      lv[i] = la * lv[i];
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      /* print result so compiler does not throw it away */
+      printf("Scalar product result: %f\n", v[0]);
+
+      elapsed_time_hr(start, end, "Double scalar multiplication (private).");
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
 
   if (MYTHREAD==0){
-    /* print result so compiler does not throw it away */
-    printf("Scalar product result: %f\n", v[0]);
-    
-    elapsed_time_hr(start, end, "Double scalar multiplication.");
-    
+
+    if (RUN_BOTH(opts)) variant_summary("Double scalar multiplication.", t_shared, t_private);
+
     upc_free(v);
   }
+
   return 0;
 
 }
@@ -428,7 +933,7 @@ int double_scalar_mult(unsigned int size){
 /*
  * compute the Euclidean norm of an int vector
  */
-int int_norm(unsigned int size){
+int int_norm(unsigned int size, bench_opts *opts){
 
   int i;
   int local_size = size/THREADS;
@@ -442,47 +947,114 @@ int int_norm(unsigned int size){
     return 0;
   }
 
-  struct timespec start, end;
+  struct timespec start, mid, end;
+  double t_shared = 0.0, t_private = 0.0;
+  int *lv;
+  int lsum, s0, s1, s2, s3;
 
-  if (MYTHREAD == 0){
-    /* fill vector with random floats */
-    for(i=0; i<size; i++){
-      v[i] = UNI;
-    }
-  }
+  /* fill the vector with random ints, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_int(v, local_size*THREADS, 1);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
   upc_barrier_timer();
 
-  part_sum[MYTHREAD] = 0;
+  if (RUN_SHARED(opts)){
 
-  upc_barrier;
+    part_sum[MYTHREAD] = 0;
 
-  clock_gettime(CLOCK, &start);
+    upc_barrier;
 
-  upc_forall (i=0; i<size; i++; &v[i]){
-    part_sum[MYTHREAD] = part_sum[MYTHREAD] + (v[i]*v[i]);
-  }
+    clock_gettime(CLOCK, &start);
 
-  upc_barrier;
+    lsum = 0;
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(int) bv = BLOCK_OF(int, v);
+      for(i=0; i<local_size; i++){
+        lsum = lsum + (bv[i]*bv[i]);
+      }
+    }
+    else{
+      upc_forall (i=0; i<size; i++; &v[i]){
+        lsum = lsum + (v[i]*v[i]);
+      }
+    }
+    part_sum[MYTHREAD] = lsum;
 
-  if(MYTHREAD==0){
-    for(i=0;i<THREADS;i++){
-      sum = sum + part_sum[i];
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    lsum = reduce_int(part_sum);
+    if(MYTHREAD==0){
+      sum = lsum;
+      norm = sqrt(sum);
+    }
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Integer vector norm.");
+      reduction_summary(start, mid, end);
+
+      /* print result so compiler does not throw it away */
+      printf("Norm = %d\n", norm);
     }
-    norm = sqrt(sum);
+
+    t_shared = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
+  if (RUN_PRIVATE(opts)){
 
-  clock_gettime(CLOCK, &end);
+    /* this thread's elements of v are contiguous in its local memory */
+    lv = (int *)&v[MYTHREAD];
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* sum of squares on private pointers */
+    s0 = s1 = s2 = s3 = 0;
+    for(i=0; i+3<local_size; i+=4){
+      s0 = s0 + (lv[i]*lv[i]);
+      s1 = s1 + (lv[i+1]*lv[i+1]);
+      s2 = s2 + (lv[i+2]*lv[i+2]);
+      s3 = s3 + (lv[i+3]*lv[i+3]);
+    }
+    for(; i<local_size; i++){
+      s0 = s0 + (lv[i]*lv[i]);
+    }
+    part_sum[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    lsum = reduce_int(part_sum);
+    if(MYTHREAD==0){
+      sum = lsum;
+      norm = sqrt(sum);
+    }
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Integer vector norm (private).");
+      reduction_summary(start, mid, end);
+
+      /* print result so compiler does not throw it away */
+      printf("Norm = %d\n", norm);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
 
   if (MYTHREAD==0){
-    elapsed_time_hr(start, end, "Integer vector norm.");
 
-    /* print result so compiler does not throw it away */
-    printf("Norm = %d\n", norm);
+    if (RUN_BOTH(opts)) variant_summary("Integer vector norm.", t_shared, t_private);
 
     upc_free(v);
   }
@@ -493,7 +1065,7 @@ int int_norm(unsigned int size){
 /*
  * compute the Euclidean norm of a float vector
  */
-int float_norm(unsigned int size){
+int float_norm(unsigned int size, bench_opts *opts){
 
   int i;
   int local_size = size/THREADS;
@@ -507,321 +1079,1553 @@ int float_norm(unsigned int size){
     return 0;
   }
 
-  struct timespec start, end;
+  struct timespec start, mid, end;
+  double t_shared = 0.0, t_private = 0.0;
+  float *lv;
+  float lsum, s0, s1, s2, s3;
 
-  if (MYTHREAD == 0){
-    /* fill vector with random floats */
-    for(i=0; i<size; i++){
-      v[i] = UNI;
+  /* fill the vector with random floats, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_float(v, local_size*THREADS, 1);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* measuring upc_forall and upc_barrier overheads */
+  upc_loop_timer_nop(local_size);
+  upc_barrier_timer();
+
+  if (RUN_SHARED(opts)){
+
+    part_sum[MYTHREAD] = 0.0;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    lsum = 0.0;
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(float) bv = BLOCK_OF(float, v);
+      for(i=0; i<local_size; i++){
+        lsum = lsum + (bv[i]*bv[i]);
+      }
+    }
+    else{
+      upc_forall (i=0; i<size; i++; &v[i]){
+        lsum = lsum + (v[i]*v[i]);
+      }
+    }
+    part_sum[MYTHREAD] = lsum;
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    lsum = reduce_float(part_sum);
+    if(MYTHREAD==0){
+      sum = lsum;
+      norm = sqrt(sum);
+    }
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Float vector norm.");
+      reduction_summary(start, mid, end);
+
+      /* print result so compiler does not throw it away */
+      printf("Norm = %f\n", norm);
+    }
+
+    t_shared = elapsed_seconds(start, end);
+  }
+
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of v are contiguous in its local memory */
+    lv = (float *)&v[MYTHREAD];
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* sum of squares on private pointers */
+    s0 = s1 = s2 = s3 = 0.0;
+    for(i=0; i+3<local_size; i+=4){
+      s0 = s0 + (lv[i]*lv[i]);
+      s1 = s1 + (lv[i+1]*lv[i+1]);
+      s2 = s2 + (lv[i+2]*lv[i+2]);
+      s3 = s3 + (lv[i+3]*lv[i+3]);
+    }
+    for(; i<local_size; i++){
+      s0 = s0 + (lv[i]*lv[i]);
+    }
+    part_sum[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    lsum = reduce_float(part_sum);
+    if(MYTHREAD==0){
+      sum = lsum;
+      norm = sqrt(sum);
     }
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Float vector norm (private).");
+      reduction_summary(start, mid, end);
+
+      /* print result so compiler does not throw it away */
+      printf("Norm = %f\n", norm);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
+
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Float vector norm.", t_shared, t_private);
+
+    upc_free(v);
+  }
+
+  return 0;
+}
+
+/*
+ * compute the Euclidean norm of a float vector
+ */
+int double_norm(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size/THREADS;
+
+  shared double *v = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *part_sum = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+  static shared double sum = 0.0, norm = 0.0;
+
+  if(v == NULL){
+    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the array.\n");
+    return 0;
   }
 
+  struct timespec start, mid, end;
+  double t_shared = 0.0, t_private = 0.0;
+  double *lv;
+  double lsum, s0, s1, s2, s3;
+
+  /* fill the vector with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(v, local_size*THREADS, 1);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
   upc_barrier_timer();
 
-  part_sum[MYTHREAD] = 0.0;
+  if (RUN_SHARED(opts)){
 
-  upc_barrier;
+    part_sum[MYTHREAD] = 0.0;
 
-  clock_gettime(CLOCK, &start);
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    lsum = 0.0;
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(double) bv = BLOCK_OF(double, v);
+      for(i=0; i<local_size; i++){
+        lsum = lsum + (bv[i]*bv[i]);
+      }
+    }
+    else{
+      upc_forall (i=0; i<size; i++; &v[i]){
+        lsum = lsum + (v[i]*v[i]);
+      }
+    }
+    part_sum[MYTHREAD] = lsum;
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    lsum = reduce_double(part_sum);
+    if(MYTHREAD==0){
+      sum = lsum;
+      norm = sqrt(sum);
+    }
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Double vector norm.");
+      reduction_summary(start, mid, end);
 
-  upc_forall (i=0; i<size; i++; &v[i]){
-    part_sum[MYTHREAD] = part_sum[MYTHREAD] + (v[i]*v[i]);
+      /* print result so compiler does not throw it away */
+      printf("Norm = %f\n", norm);
+    }
+
+    t_shared = elapsed_seconds(start, end);
   }
 
-  upc_barrier;
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of v are contiguous in its local memory */
+    lv = (double *)&v[MYTHREAD];
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    /* sum of squares on private pointers */
+    s0 = s1 = s2 = s3 = 0.0;
+    for(i=0; i+3<local_size; i+=4){
+      s0 = s0 + (lv[i]*lv[i]);
+      s1 = s1 + (lv[i+1]*lv[i+1]);
+      s2 = s2 + (lv[i+2]*lv[i+2]);
+      s3 = s3 + (lv[i+3]*lv[i+3]);
+    }
+    for(; i<local_size; i++){
+      s0 = s0 + (lv[i]*lv[i]);
+    }
+    part_sum[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+    upc_barrier;
+    clock_gettime(CLOCK, &mid);
+
+    lsum = reduce_double(part_sum);
+    if(MYTHREAD==0){
+      sum = lsum;
+      norm = sqrt(sum);
+    }
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Double vector norm (private).");
+      reduction_summary(start, mid, end);
+
+      /* print result so compiler does not throw it away */
+      printf("Norm = %f\n", norm);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
+
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Double vector norm.", t_shared, t_private);
+
+    upc_free(v);
+  }
+
+  return 0;
+}
+
+/*
+ *
+ * Compute vector-scalar product
+ * AXPY, integers
+ *
+ * y = a * x + y
+ *
+ * Naive implementation
+ *
+ */
+int int_axpy(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  static shared int a;
+
+  shared int *x = (shared int *)upc_all_alloc(THREADS, local_size * sizeof(int));
+  shared int *y = (shared int *)upc_all_alloc(THREADS, local_size * sizeof(int));
+
+  if(x == NULL || y == NULL){
+    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the two arrays.\n");
+    return 0;
+  }
+
+  struct timespec start, end;
+  double t_shared = 0.0, t_private = 0.0;
+  int *lx, *ly;
+  int la;
+
+  /* fill the vectors and scalar with random ints, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_int(x, local_size*THREADS, 1);
+  fill_int(y, local_size*THREADS, 2);
+  if (MYTHREAD == 0) a = rand_int(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* measuring upc_forall and upc_barrier overheads */
+  upc_loop_timer_nop(local_size);
+  upc_barrier_timer();
+
+  if (RUN_SHARED(opts)){
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(int) bx = BLOCK_OF(int, x);
+      BLOCK_PTR(int) by = BLOCK_OF(int, y);
+      for(i=0; i<local_size; i++){
+        by[i] = a * bx[i] + by[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<size; i++; &y[i]){
+        y[i] = a * x[i] + y[i];
+      }
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Int AXPY.");
+
+      /* print some of the result so compiler does not throw it away */
+      printf("APXY result = %d\n", y[0]);
+    }
+
+    t_shared = elapsed_seconds(start, end);
+  }
+
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of x and y are contiguous in its local memory */
+    lx = (int *)&x[MYTHREAD];
+    ly = (int *)&y[MYTHREAD];
+    la = a;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    for(i=0; i<local_size; i++){
+      ly[i] = la * lx[i] + ly[i];
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Int AXPY (private).");
+
+      /* print some of the result so compiler does not throw it away */
+      printf("APXY result = %d\n", y[0]);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
+
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Int AXPY.", t_shared, t_private);
+
+    upc_free(x);
+    upc_free(y);
+  }
+
+  return 0;
+}
+
+/*
+ *
+ * Compute vector-scalar product
+ * AXPY, floats
+ *
+ * y = a * x + y
+ *
+ * Naive implementation
+ *
+ */
+int float_axpy(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  static shared float a;
+
+  shared float *x = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
+  shared float *y = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
+
+  if(x == NULL || y == NULL){
+	if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the two arrays.\n");
+    return 0;
+  }
+
+  struct timespec start, end;
+  double t_shared = 0.0, t_private = 0.0;
+  float *lx, *ly;
+  float la;
+
+  /* fill the vectors and scalar with random floats, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_float(x, local_size*THREADS, 1);
+  fill_float(y, local_size*THREADS, 2);
+  if (MYTHREAD == 0) a = rand_float(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* measuring upc_forall and upc_barrier overheads */
+  upc_loop_timer_nop(local_size);
+  upc_barrier_timer();
+
+  if (RUN_SHARED(opts)){
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(float) bx = BLOCK_OF(float, x);
+      BLOCK_PTR(float) by = BLOCK_OF(float, y);
+      for(i=0; i<local_size; i++){
+        by[i] = a * bx[i] + by[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
+        y[i] = a * x[i] + y[i];
+      }
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Float AXPY.");
+
+      /* print some of the result so compiler does not throw it away */
+      printf("APXY result = %f\n", y[0]);
+    }
+
+    t_shared = elapsed_seconds(start, end);
+  }
+
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of x and y are contiguous in its local memory */
+    lx = (float *)&x[MYTHREAD];
+    ly = (float *)&y[MYTHREAD];
+    la = a;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    for(i=0; i<local_size; i++){
+      ly[i] = la * lx[i] + ly[i];
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Float AXPY (private).");
+
+      /* print some of the result so compiler does not throw it away */
+      printf("APXY result = %f\n", y[0]);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
+
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Float AXPY.", t_shared, t_private);
+
+    upc_free(x);
+    upc_free(y);
+  }
+
+  return 0;
+}
+
+/*
+ *
+ * Compute vector-scalar product
+ * AXPY, doubles
+ *
+ * y = a * x + y
+ *
+ * Naive implementation
+ *
+ */
+int double_axpy(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  static shared double a;
+
+  shared double *x = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *y = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+
+  if(x == NULL || y == NULL){
+	if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the two arrays.\n");
+    return 0;
+  }
+
+  struct timespec start, end;
+  double t_shared = 0.0, t_private = 0.0;
+  double *lx, *ly;
+  double la;
+
+  /* fill the vectors and scalar with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(x, local_size*THREADS, 1);
+  fill_double(y, local_size*THREADS, 2);
+  if (MYTHREAD == 0) a = rand_double(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* measuring upc_forall and upc_barrier overheads */
+  upc_loop_timer_nop(local_size);
+  upc_barrier_timer();
+
+  if (RUN_SHARED(opts)){
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    if (LAYOUT_BLOCKED(opts)){
+      BLOCK_PTR(double) bx = BLOCK_OF(double, x);
+      BLOCK_PTR(double) by = BLOCK_OF(double, y);
+      for(i=0; i<local_size; i++){
+        by[i] = a * bx[i] + by[i];
+      }
+    }
+    else{
+      upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
+        y[i] = a * x[i] + y[i];
+      }
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Double AXPY.");
+
+      /* print some of the result so compiler does not throw it away */
+      printf("APXY result = %f\n", y[0]);
+    }
+
+    t_shared = elapsed_seconds(start, end);
+  }
+
+  if (RUN_PRIVATE(opts)){
+
+    /* this thread's elements of x and y are contiguous in its local memory */
+    lx = (double *)&x[MYTHREAD];
+    ly = (double *)&y[MYTHREAD];
+    la = a;
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &start);
+
+    for(i=0; i<local_size; i++){
+      ly[i] = la * lx[i] + ly[i];
+    }
+
+    upc_barrier;
+
+    clock_gettime(CLOCK, &end);
+
+    if (MYTHREAD==0){
+      elapsed_time_hr(start, end, "Double AXPY (private).");
+
+      /* print some of the result so compiler does not throw it away */
+      printf("APXY result = %f\n", y[0]);
+    }
+
+    t_private = elapsed_seconds(start, end);
+  }
+
+  if (MYTHREAD==0){
+
+    if (RUN_BOTH(opts)) variant_summary("Double AXPY.", t_shared, t_private);
+
+    upc_free(x);
+    upc_free(y);
+  }
+
+  return 0;
+}
+
+/*
+ * Fused AXPY and dot product, doubles
+ *
+ * y = a * x + y, then result = y . z
+ *
+ * As an iterative solver calls the two kernels back to back.  Run once
+ * as the separate kernels, which stream y twice, and once fused into a
+ * single pass that uses each element of y as soon as it is updated, on
+ * private pointers in both cases.
+ */
+int double_axpy_dot(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  static shared double a;
+
+  shared double *x = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *y = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *z = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *tmp_result = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  if(x == NULL || y == NULL || z == NULL){
+    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the three arrays.\n");
+    return 0;
+  }
+
+  struct timespec start, end;
+  double t_separate, t_fused, r_separate, r_fused;
+  double *lx, *ly, *lz;
+  double la, s0, s1, s2, s3;
+
+  /* fill the vectors and scalar with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(x, local_size*THREADS, 1);
+  fill_double(y, local_size*THREADS, 2);
+  fill_double(z, local_size*THREADS, 3);
+  if (MYTHREAD == 0) a = rand_double(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* this thread's elements of x, y and z are contiguous in its local memory */
+  lx = (double *)&x[MYTHREAD];
+  ly = (double *)&y[MYTHREAD];
+  lz = (double *)&z[MYTHREAD];
+  la = a;
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  /* separate kernels: AXPY, then the dot product */
+  for(i=0; i<local_size; i++){
+    ly[i] = la * lx[i] + ly[i];
+  }
+
+  upc_barrier;
+
+  s0 = s1 = s2 = s3 = 0.0;
+  for(i=0; i+3<local_size; i+=4){
+    s0 = s0 + ly[i] * lz[i];
+    s1 = s1 + ly[i+1] * lz[i+1];
+    s2 = s2 + ly[i+2] * lz[i+2];
+    s3 = s3 + ly[i+3] * lz[i+3];
+  }
+  for(; i<local_size; i++){
+    s0 = s0 + ly[i] * lz[i];
+  }
+  tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+  upc_barrier;
+
+  r_separate = reduce_double(tmp_result);
+
+  clock_gettime(CLOCK, &end);
+
+  t_separate = elapsed_seconds(start, end);
+
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Double AXPY then dot product (separate).");
+
+    /* print result so compiler does not throw it away */
+    printf("Dot product result: %f\n", r_separate);
+  }
+
+  /* start again from the same y */
+  fill_double(y, local_size*THREADS, 2);
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  /* fused kernel: each element of y is updated and used in a single pass */
+  s0 = s1 = s2 = s3 = 0.0;
+  for(i=0; i+3<local_size; i+=4){
+    ly[i] = la * lx[i] + ly[i];
+    ly[i+1] = la * lx[i+1] + ly[i+1];
+    ly[i+2] = la * lx[i+2] + ly[i+2];
+    ly[i+3] = la * lx[i+3] + ly[i+3];
+    s0 = s0 + ly[i] * lz[i];
+    s1 = s1 + ly[i+1] * lz[i+1];
+    s2 = s2 + ly[i+2] * lz[i+2];
+    s3 = s3 + ly[i+3] * lz[i+3];
+  }
+  for(; i<local_size; i++){
+    ly[i] = la * lx[i] + ly[i];
+    s0 = s0 + ly[i] * lz[i];
+  }
+  tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+  upc_barrier;
+
+  r_fused = reduce_double(tmp_result);
+
+  clock_gettime(CLOCK, &end);
+
+  t_fused = elapsed_seconds(start, end);
+
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Double AXPY then dot product (fused).");
+
+    /* print result so compiler does not throw it away */
+    printf("Dot product result: %f\n", r_fused);
+
+    /* AXPY reads x and y and writes y, the dot product reads y and z again */
+    fused_summary("Double AXPY then dot product.", t_separate, t_fused,
+		  5.0*local_size*THREADS*sizeof(double), 4.0*local_size*THREADS*sizeof(double));
+
+    upc_free(x);
+    upc_free(y);
+    upc_free(z);
+    upc_free(tmp_result);
+  }
+
+  return 0;
+}
+
+/*
+ * Fused scalar multiplication and Euclidean norm, doubles
+ *
+ * x = a * x, then result = ||x||
+ *
+ * Run once as the separate kernels, which stream x twice, and once fused
+ * into a single pass, on private pointers in both cases.
+ */
+int double_scal_norm(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  static shared double a;
+
+  shared double *x = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *tmp_result = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  if(x == NULL){
+    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the array.\n");
+    return 0;
+  }
+
+  struct timespec start, end;
+  double t_separate, t_fused, r_separate, r_fused;
+  double *lx;
+  double la, s0, s1, s2, s3;
+
+  /* fill the vector and scalar with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(x, local_size*THREADS, 1);
+  if (MYTHREAD == 0) a = rand_double(0, 0);
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* this thread's elements of x are contiguous in its local memory */
+  lx = (double *)&x[MYTHREAD];
+  la = a;
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  /* separate kernels: scalar multiplication, then the norm */
+  for(i=0; i<local_size; i++){
+    lx[i] = la * lx[i];
+  }
+
+  upc_barrier;
+
+  s0 = s1 = s2 = s3 = 0.0;
+  for(i=0; i+3<local_size; i+=4){
+    s0 = s0 + lx[i] * lx[i];
+    s1 = s1 + lx[i+1] * lx[i+1];
+    s2 = s2 + lx[i+2] * lx[i+2];
+    s3 = s3 + lx[i+3] * lx[i+3];
+  }
+  for(; i<local_size; i++){
+    s0 = s0 + lx[i] * lx[i];
+  }
+  tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+  upc_barrier;
+
+  r_separate = sqrt(reduce_double(tmp_result));
+
+  clock_gettime(CLOCK, &end);
+
+  t_separate = elapsed_seconds(start, end);
+
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Double scalar multiplication then norm (separate).");
+
+    /* print result so compiler does not throw it away */
+    printf("Norm = %f\n", r_separate);
+  }
+
+  /* start again from the same x */
+  fill_double(x, local_size*THREADS, 1);
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  /* fused kernel: each element of x is scaled and squared in a single pass */
+  s0 = s1 = s2 = s3 = 0.0;
+  for(i=0; i+3<local_size; i+=4){
+    lx[i] = la * lx[i];
+    lx[i+1] = la * lx[i+1];
+    lx[i+2] = la * lx[i+2];
+    lx[i+3] = la * lx[i+3];
+    s0 = s0 + lx[i] * lx[i];
+    s1 = s1 + lx[i+1] * lx[i+1];
+    s2 = s2 + lx[i+2] * lx[i+2];
+    s3 = s3 + lx[i+3] * lx[i+3];
+  }
+  for(; i<local_size; i++){
+    lx[i] = la * lx[i];
+    s0 = s0 + lx[i] * lx[i];
+  }
+  tmp_result[MYTHREAD] = (s0 + s1) + (s2 + s3);
+
+  upc_barrier;
+
+  r_fused = sqrt(reduce_double(tmp_result));
+
+  clock_gettime(CLOCK, &end);
+
+  t_fused = elapsed_seconds(start, end);
+
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Double scalar multiplication then norm (fused).");
+
+    /* print result so compiler does not throw it away */
+    printf("Norm = %f\n", r_fused);
+
+    /* the scalar multiplication reads and writes x, the norm reads it again */
+    fused_summary("Double scalar multiplication then norm.", t_separate, t_fused,
+		  3.0*local_size*THREADS*sizeof(double), 2.0*local_size*THREADS*sizeof(double));
+
+    upc_free(x);
+    upc_free(tmp_result);
+  }
+
+  return 0;
+}
+
+/*
+ * Scaled vector sum, doubles
+ *
+ * w = a * x + b * y
+ *
+ * Run once as the BLAS-1 sequence it replaces, copying y to w, scaling w
+ * by b and adding a * x, which streams w three times, and once fused into
+ * a single pass, on private pointers in both cases.
+ */
+int double_waxpby(unsigned int size, bench_opts *opts){
+
+  int i;
+  int local_size = size / THREADS;
+
+  static shared double a, b;
+
+  shared double *x = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *y = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+  shared double *w = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
+
+  if(x == NULL || y == NULL || w == NULL){
+    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the three arrays.\n");
+    return 0;
+  }
+
+  struct timespec start, end;
+  double t_separate, t_fused;
+  double *lx, *ly, *lw;
+  double la, lb;
+
+  /* fill the vectors and scalars with random doubles, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(x, local_size*THREADS, 1);
+  fill_double(y, local_size*THREADS, 2);
+  if (MYTHREAD == 0){
+    a = rand_double(0, 0);
+    b = rand_double(0, 1);
+  }
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
+
+  /* this thread's elements of x, y and w are contiguous in its local memory */
+  lx = (double *)&x[MYTHREAD];
+  ly = (double *)&y[MYTHREAD];
+  lw = (double *)&w[MYTHREAD];
+  la = a;
+  lb = b;
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  /* separate kernels: copy, scalar multiplication and AXPY */
+  for(i=0; i<local_size; i++){
+    lw[i] = ly[i];
+  }
+
+  upc_barrier;
+
+  for(i=0; i<local_size; i++){
+    lw[i] = lb * lw[i];
+  }
+
+  upc_barrier;
+
+  for(i=0; i<local_size; i++){
+    lw[i] = la * lx[i] + lw[i];
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  t_separate = elapsed_seconds(start, end);
+
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Double WAXPBY (separate).");
+
+    /* print some of the result so compiler does not throw it away */
+    printf("WAXPBY result = %f\n", w[0]);
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &start);
+
+  /* fused kernel */
+  for(i=0; i<local_size; i++){
+    lw[i] = la * lx[i] + lb * ly[i];
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  t_fused = elapsed_seconds(start, end);
+
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Double WAXPBY (fused).");
+
+    /* print some of the result so compiler does not throw it away */
+    printf("WAXPBY result = %f\n", w[0]);
+
+    /* the copy reads y and writes w, the scaling reads and writes w, and the AXPY reads x and w and writes w */
+    fused_summary("Double WAXPBY.", t_separate, t_fused,
+		  7.0*local_size*THREADS*sizeof(double), 3.0*local_size*THREADS*sizeof(double));
+
+    upc_free(x);
+    upc_free(y);
+    upc_free(w);
+  }
+
+  return 0;
+}
+
+/* Columns of A per pass of the private GEMV, so that the chunk of x stays in cache */
+#define GEMV_COLS 2048
+
+/*
+ * Partial sums per row of the floating-point GEMVs.  A single sum per row
+ * is a reduction the compiler will not vectorise without reassociating
+ * the adds, which it may not do for floating point, so lane l sums the
+ * columns j with j % GEMV_LANES == l and the lanes are independent.  The
+ * lanes are added up at the end of each chunk of columns.
+ */
+#define GEMV_LANES 8
+
+/* sum of the GEMV_LANES partial sums of a row */
+static float lanes_float(const float *s){
+
+  int l;
+  float sum = 0;
 
-  if(MYTHREAD==0){
-    for(i=0;i<THREADS;i++){
-      sum = sum + part_sum[i];
-    }
-    norm = sqrt(sum);
+  for(l=0; l<GEMV_LANES; l++){
+    sum = sum + s[l];
   }
 
-  upc_barrier;
+  return sum;
+}
 
-  clock_gettime(CLOCK, &end);
+static double lanes_double(const double *s){
 
-  if (MYTHREAD==0){
-    elapsed_time_hr(start, end, "Float vector norm.");
-    
-    /* print result so compiler does not throw it away */
-    printf("Norm = %f\n", norm);
-    
-    upc_free(v);
+  int l;
+  double sum = 0;
+
+  for(l=0; l<GEMV_LANES; l++){
+    sum = sum + s[l];
   }
 
-  return 0;
+  return sum;
 }
 
 /*
- * compute the Euclidean norm of a float vector
+ * Rate of an n x n dense matrix-vector product of elem byte elements,
+ * against the traffic of reading A and x and writing y once each
  */
-int double_norm(unsigned int size){
-
-  int i;
-  int local_size = size/THREADS;
+static void dmatvec_summary(int n, size_t elem, double seconds){
 
-  shared double *v = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
-  shared double *part_sum = (shared double *)upc_all_alloc(THREADS, sizeof(double));
-  static shared double sum = 0.0, norm = 0.0;
+  rate_summary(2.0*n*n, ((double)n*n + 2.0*n)*elem, seconds);
+}
 
-  if(v == NULL){
-    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the array.\n");
-    return 0;
+/*
+ * y = A*x for a private block of rows x n elements of A, stored by rows.
+ * The columns are taken GEMV_COLS at a time, so that the chunk of x stays
+ * in cache while four rows at a time stream past it, each into its own
+ * accumulator.  Integer adds associate, so the compiler can vectorise the
+ * unit stride inner loop as it stands.
+ */
+static void gemv_int(const int *A, const int *x, int *y, int rows, int n){
+
+  int i, j, jb, je;
+  const int *a0, *a1, *a2, *a3;
+  int s0, s1, s2, s3;
+
+  for(i=0; i<rows; i++){
+    y[i] = 0;
+  }
+
+  for(jb=0; jb<n; jb+=GEMV_COLS){
+    je = (jb + GEMV_COLS < n) ? jb + GEMV_COLS : n;
+
+    for(i=0; i+3<rows; i+=4){
+      a0 = A + (size_t)i*n;
+      a1 = a0 + n;
+      a2 = a1 + n;
+      a3 = a2 + n;
+      s0 = s1 = s2 = s3 = 0;
+      for(j=jb; j<je; j++){
+        s0 = s0 + a0[j] * x[j];
+        s1 = s1 + a1[j] * x[j];
+        s2 = s2 + a2[j] * x[j];
+        s3 = s3 + a3[j] * x[j];
+      }
+      y[i] = y[i] + s0;
+      y[i+1] = y[i+1] + s1;
+      y[i+2] = y[i+2] + s2;
+      y[i+3] = y[i+3] + s3;
+    }
+    for(; i<rows; i++){
+      a0 = A + (size_t)i*n;
+      s0 = 0;
+      for(j=jb; j<je; j++){
+        s0 = s0 + a0[j] * x[j];
+      }
+      y[i] = y[i] + s0;
+    }
   }
+}
 
-  struct timespec start, end;
+/*
+ * y = A*x for a private block of rows x n elements of A, stored by rows.
+ * The columns are taken GEMV_COLS at a time, so that the chunk of x stays
+ * in cache while four rows at a time stream past it, each into its own
+ * GEMV_LANES partial sums.
+ */
+static void gemv_float(const float *A, const float *x, float *y, int rows, int n){
 
-  if (MYTHREAD == 0){
-    /* fill vector with random floats */
-    for(i=0; i<size; i++){
-      v[i] = UNI;
-    }
+  int i, j, l, jb, je, jv;
+  const float *a0, *a1, *a2, *a3;
+  float s0[GEMV_LANES], s1[GEMV_LANES], s2[GEMV_LANES], s3[GEMV_LANES];
+
+  for(i=0; i<rows; i++){
+    y[i] = 0;
   }
 
-  /* measuring upc_forall and upc_barrier overheads */
-  upc_loop_timer_nop(local_size);
-  upc_barrier_timer();
+  for(jb=0; jb<n; jb+=GEMV_COLS){
+    je = (jb + GEMV_COLS < n) ? jb + GEMV_COLS : n;
+    jv = jb + (je - jb) / GEMV_LANES * GEMV_LANES;
 
-  part_sum[MYTHREAD] = 0.0;
+    for(i=0; i+3<rows; i+=4){
+      a0 = A + (size_t)i*n;
+      a1 = a0 + n;
+      a2 = a1 + n;
+      a3 = a2 + n;
+      for(l=0; l<GEMV_LANES; l++){
+        s0[l] = s1[l] = s2[l] = s3[l] = 0;
+      }
+      for(j=jb; j<jv; j+=GEMV_LANES){
+        for(l=0; l<GEMV_LANES; l++){
+          s0[l] = s0[l] + a0[j+l] * x[j+l];
+          s1[l] = s1[l] + a1[j+l] * x[j+l];
+          s2[l] = s2[l] + a2[j+l] * x[j+l];
+          s3[l] = s3[l] + a3[j+l] * x[j+l];
+        }
+      }
+      for(; j<je; j++){
+        s0[0] = s0[0] + a0[j] * x[j];
+        s1[0] = s1[0] + a1[j] * x[j];
+        s2[0] = s2[0] + a2[j] * x[j];
+        s3[0] = s3[0] + a3[j] * x[j];
+      }
+      y[i] = y[i] + lanes_float(s0);
+      y[i+1] = y[i+1] + lanes_float(s1);
+      y[i+2] = y[i+2] + lanes_float(s2);
+      y[i+3] = y[i+3] + lanes_float(s3);
+    }
+    for(; i<rows; i++){
+      a0 = A + (size_t)i*n;
+      for(l=0; l<GEMV_LANES; l++){
+        s0[l] = 0;
+      }
+      for(j=jb; j<jv; j+=GEMV_LANES){
+        for(l=0; l<GEMV_LANES; l++){
+          s0[l] = s0[l] + a0[j+l] * x[j+l];
+        }
+      }
+      for(; j<je; j++){
+        s0[0] = s0[0] + a0[j] * x[j];
+      }
+      y[i] = y[i] + lanes_float(s0);
+    }
+  }
+}
 
-  upc_barrier;
+/*
+ * y = A*x for a private block of rows x n elements of A, stored by rows.
+ * The columns are taken GEMV_COLS at a time, so that the chunk of x stays
+ * in cache while four rows at a time stream past it, each into its own
+ * GEMV_LANES partial sums.
+ */
+static void gemv_double(const double *A, const double *x, double *y, int rows, int n){
 
-  clock_gettime(CLOCK, &start);
+  int i, j, l, jb, je, jv;
+  const double *a0, *a1, *a2, *a3;
+  double s0[GEMV_LANES], s1[GEMV_LANES], s2[GEMV_LANES], s3[GEMV_LANES];
 
-  upc_forall (i=0; i<size; i++; &v[i]){
-    part_sum[MYTHREAD] = part_sum[MYTHREAD] + (v[i]*v[i]);
+  for(i=0; i<rows; i++){
+    y[i] = 0;
   }
 
-  upc_barrier;
+  for(jb=0; jb<n; jb+=GEMV_COLS){
+    je = (jb + GEMV_COLS < n) ? jb + GEMV_COLS : n;
+    jv = jb + (je - jb) / GEMV_LANES * GEMV_LANES;
 
-  if(MYTHREAD==0){
-    for(i=0;i<THREADS;i++){
-      sum = sum + part_sum[i];
+    for(i=0; i+3<rows; i+=4){
+      a0 = A + (size_t)i*n;
+      a1 = a0 + n;
+      a2 = a1 + n;
+      a3 = a2 + n;
+      for(l=0; l<GEMV_LANES; l++){
+        s0[l] = s1[l] = s2[l] = s3[l] = 0;
+      }
+      for(j=jb; j<jv; j+=GEMV_LANES){
+        for(l=0; l<GEMV_LANES; l++){
+          s0[l] = s0[l] + a0[j+l] * x[j+l];
+          s1[l] = s1[l] + a1[j+l] * x[j+l];
+          s2[l] = s2[l] + a2[j+l] * x[j+l];
+          s3[l] = s3[l] + a3[j+l] * x[j+l];
+        }
+      }
+      for(; j<je; j++){
+        s0[0] = s0[0] + a0[j] * x[j];
+        s1[0] = s1[0] + a1[j] * x[j];
+        s2[0] = s2[0] + a2[j] * x[j];
+        s3[0] = s3[0] + a3[j] * x[j];
+      }
+      y[i] = y[i] + lanes_double(s0);
+      y[i+1] = y[i+1] + lanes_double(s1);
+      y[i+2] = y[i+2] + lanes_double(s2);
+      y[i+3] = y[i+3] + lanes_double(s3);
+    }
+    for(; i<rows; i++){
+      a0 = A + (size_t)i*n;
+      for(l=0; l<GEMV_LANES; l++){
+        s0[l] = 0;
+      }
+      for(j=jb; j<jv; j+=GEMV_LANES){
+        for(l=0; l<GEMV_LANES; l++){
+          s0[l] = s0[l] + a0[j+l] * x[j+l];
+        }
+      }
+      for(; j<je; j++){
+        s0[0] = s0[0] + a0[j] * x[j];
+      }
+      y[i] = y[i] + lanes_double(s0);
     }
-    norm = sqrt(sum);
   }
+}
 
-  upc_barrier;
+/* record this thread's times of the gather of x and of the local multiply, before the barrier that ends the product */
+static void gather_times(shared double *tgath, shared double *tmult, struct timespec start, struct timespec mid, struct timespec done){
 
-  clock_gettime(CLOCK, &end);
+  tgath[MYTHREAD] = elapsed_seconds(start, mid);
+  tmult[MYTHREAD] = elapsed_seconds(mid, done);
+}
 
-  if (MYTHREAD==0){
-    elapsed_time_hr(start, end, "Double vector norm.");
+/* the largest gather and multiply times over the threads, on thread 0 after that barrier */
+static void gather_summary(shared double *tgath, shared double *tmult){
 
-    /* print result so compiler does not throw it away */
-    printf("Norm = %f\n", norm);
+  int t;
+  double gather = 0.0, multiply = 0.0;
 
-    upc_free(v);
+  for (t = 0; t < THREADS; t++) {
+    if (tgath[t] > gather) gather = tgath[t];
+    if (tmult[t] > multiply) multiply = tmult[t];
   }
 
-  return 0;
+  printf("Gather: %.9lf s   Local multiply: %.9lf s   (largest over the threads)\n", gather, multiply);
 }
 
 /*
+ * Dense Matrix-Vector product on a row-block layout, ints
  *
- * Compute vector-scalar product
- * AXPY, integers
- *
- * y = a * x + y
- *
- * Naive implementation
- *
+ * Each thread owns local_size consecutive rows of A with the matching
+ * elements of x and y, all in its local memory.  x is gathered once into
+ * a private copy with one-sided gets, after which the product of the
+ * local rows is a private GEMV with no shared accesses.  Collective;
+ * returns the time of the product, gather included.
  */
-int int_axpy(unsigned int size){
-
-  int i;
-  int local_size = size / THREADS;
+static double int_dmatvec_rows(int local_size){
 
-  static shared int a;
+  int k, r, c, t;
+  int n = local_size*THREADS;
 
+  shared int *A = (shared int *)upc_all_alloc(THREADS, (size_t)local_size*n * sizeof(int));
   shared int *x = (shared int *)upc_all_alloc(THREADS, local_size * sizeof(int));
   shared int *y = (shared int *)upc_all_alloc(THREADS, local_size * sizeof(int));
-
-  if(x == NULL || y == NULL){
-    if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the two arrays.\n");
-    return 0;
+  int *xp = (int *)malloc(n * sizeof(int));
+  shared double *tgath = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+  shared double *tmult = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  /* xp is private, so every thread must hear of a failure before any returns */
+  if(any_thread(x == NULL || y == NULL || A == NULL || xp == NULL || tgath == NULL || tmult == NULL)){
+    if (MYTHREAD==0){
+      printf("Out Of Memory: could not allocate space for the row-block vectors and matrix.\n");
+      upc_free(x);
+      upc_free(y);
+      upc_free(A);
+      upc_free(tgath);
+      upc_free(tmult);
+    }
+    free(xp);
+    return 0.0;
   }
 
-  if(MYTHREAD==0){
+  struct timespec start, mid, done, end;
+  double seconds;
 
-    a = KISS;
-    
-    /* fill x and y vectors with random ints */
-    for(i=0; i<size; i++){
-      x[i] = KISS;
-      y[i] = KISS;
+  /* this thread's rows, and its elements of x and y, are contiguous in its local memory */
+  int *la = (int *)&A[MYTHREAD];
+  int *lx = (int *)&x[MYTHREAD];
+  int *ly = (int *)&y[MYTHREAD];
+  int i0 = MYTHREAD*local_size;
+
+  /* fill with the same values as the cyclic layout, each thread its own rows */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  for(k=0; k<local_size; k++){
+    lx[k] = rand_int(1, i0 + k);
+  }
+  for(r=0; r<local_size; r++){
+    for(c=0; c<n; c++){
+      la[(size_t)r*n + c] = rand_int(2, (unsigned long)(i0 + r)*n + c);
     }
   }
-
-  struct timespec start, end;
-
-  /* measuring upc_forall and upc_barrier overheads */
-  upc_loop_timer_nop(local_size);
-  upc_barrier_timer();
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   upc_barrier;
 
   clock_gettime(CLOCK, &start);
 
-  upc_forall(i=0; i<size; i++; &y[i]){
-    y[i] = a * x[i] + y[i];
+  /* gather x, starting from the next thread so that they do not all read from the same one */
+  for(k=1; k<=THREADS; k++){
+    t = (MYTHREAD + k) % THREADS;
+    upc_memget(xp + (size_t)t*local_size, &x[t], local_size * sizeof(int));
   }
 
+  clock_gettime(CLOCK, &mid);
+
+  /* perform matrix-vector product on the local rows */
+  gemv_int(la, xp, ly, local_size, n);
+
+  clock_gettime(CLOCK, &done);
+  gather_times(tgath, tmult, start, mid, done);
+
   upc_barrier;
 
   clock_gettime(CLOCK, &end);
 
-  if (MYTHREAD == 0){
+  seconds = elapsed_seconds(start, end);
 
-    elapsed_time_hr(start, end, "Int AXPY.");
+  if (MYTHREAD==0){
+    elapsed_time_hr(start, end, "Integer Dense Matrix-Vector product (private).");
+    gather_summary(tgath, tmult);
+    dmatvec_summary(n, sizeof(int), seconds);
 
-    /* print some of the result so compiler does not throw it away */
-    printf("APXY result = %d\n", y[0]);
+    /* print result so compiler does not throw it away */
+    printf("Result vector y[0] = %d\n", y[0]);
+  }
+
+  free(xp);
+
+  upc_barrier;
 
+  if (MYTHREAD==0){
     upc_free(x);
     upc_free(y);
-
+    upc_free(A);
+    upc_free(tgath);
+    upc_free(tmult);
   }
 
-  return 0;
+  return seconds;
 }
 
 /*
+ * Dense Matrix-Vector product on a row-block layout, floats
  *
- * Compute vector-scalar product
- * AXPY, floats
- *
- * y = a * x + y
- *
- * Naive implementation
- *
+ * Each thread owns local_size consecutive rows of A with the matching
+ * elements of x and y, all in its local memory.  x is gathered once into
+ * a private copy with one-sided gets, after which the product of the
+ * local rows is a private GEMV with no shared accesses.  Collective;
+ * returns the time of the product, gather included.
  */
-int float_axpy(unsigned int size){
+static double float_dmatvec_rows(int local_size){
 
-  int i;
-  int local_size = size / THREADS;
-
-  static shared float a;
+  int k, r, c, t;
+  int n = local_size*THREADS;
 
+  shared float *A = (shared float *)upc_all_alloc(THREADS, (size_t)local_size*n * sizeof(float));
   shared float *x = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
   shared float *y = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
-
-  if(x == NULL || y == NULL){
-	if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the two arrays.\n");
-    return 0;
+  float *xp = (float *)malloc(n * sizeof(float));
+  shared double *tgath = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+  shared double *tmult = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  /* xp is private, so every thread must hear of a failure before any returns */
+  if(any_thread(x == NULL || y == NULL || A == NULL || xp == NULL || tgath == NULL || tmult == NULL)){
+    if (MYTHREAD==0){
+      printf("Out Of Memory: could not allocate space for the row-block vectors and matrix.\n");
+      upc_free(x);
+      upc_free(y);
+      upc_free(A);
+      upc_free(tgath);
+      upc_free(tmult);
+    }
+    free(xp);
+    return 0.0;
   }
 
-  if(MYTHREAD==0){
+  struct timespec start, mid, done, end;
+  double seconds;
 
-	a = UNI;
+  /* this thread's rows, and its elements of x and y, are contiguous in its local memory */
+  float *la = (float *)&A[MYTHREAD];
+  float *lx = (float *)&x[MYTHREAD];
+  float *ly = (float *)&y[MYTHREAD];
+  int i0 = MYTHREAD*local_size;
 
-    /* fill x and y vectors with random ints */
-    for(i=0; i<size; i++){
-      x[i] = UNI;
-      y[i] = UNI;
+  /* fill with the same values as the cyclic layout, each thread its own rows */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  for(k=0; k<local_size; k++){
+    lx[k] = rand_float(1, i0 + k);
+  }
+  for(r=0; r<local_size; r++){
+    for(c=0; c<n; c++){
+      la[(size_t)r*n + c] = rand_float(2, (unsigned long)(i0 + r)*n + c);
     }
-
   }
-
-  struct timespec start, end;
-
-  /* measuring upc_forall and upc_barrier overheads */
-  upc_loop_timer_nop(local_size);
-  upc_barrier_timer();
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   upc_barrier;
 
   clock_gettime(CLOCK, &start);
 
-  upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
-    y[i] = a * x[i] + y[i];
+  /* gather x, starting from the next thread so that they do not all read from the same one */
+  for(k=1; k<=THREADS; k++){
+    t = (MYTHREAD + k) % THREADS;
+    upc_memget(xp + (size_t)t*local_size, &x[t], local_size * sizeof(float));
   }
 
+  clock_gettime(CLOCK, &mid);
+
+  /* perform matrix-vector product on the local rows */
+  gemv_float(la, xp, ly, local_size, n);
+
+  clock_gettime(CLOCK, &done);
+  gather_times(tgath, tmult, start, mid, done);
+
   upc_barrier;
 
   clock_gettime(CLOCK, &end);
 
+  seconds = elapsed_seconds(start, end);
+
   if (MYTHREAD==0){
-	elapsed_time_hr(start, end, "Float AXPY.");
+    elapsed_time_hr(start, end, "Float Dense Matrix-Vector product (private).");
+    gather_summary(tgath, tmult);
+    dmatvec_summary(n, sizeof(float), seconds);
 
-    /* print some of the result so compiler does not throw it away */
-    printf("APXY result = %f\n", y[0]);
+    /* print result so compiler does not throw it away */
+    printf("Result vector y[0] = %f\n", y[0]);
+  }
+
+  free(xp);
 
+  upc_barrier;
+
+  if (MYTHREAD==0){
     upc_free(x);
     upc_free(y);
+    upc_free(A);
+    upc_free(tgath);
+    upc_free(tmult);
   }
 
-  return 0;
+  return seconds;
 }
 
 /*
+ * Dense Matrix-Vector product on a row-block layout, doubles
  *
- * Compute vector-scalar product
- * AXPY, doubles
- *
- * y = a * x + y
- *
- * Naive implementation
- *
+ * Each thread owns local_size consecutive rows of A with the matching
+ * elements of x and y, all in its local memory.  x is gathered once into
+ * a private copy with one-sided gets, after which the product of the
+ * local rows is a private GEMV with no shared accesses.  Collective;
+ * returns the time of the product, gather included.
  */
-int double_axpy(unsigned int size){
+static double double_dmatvec_rows(int local_size){
 
-  int i;
-  int local_size = size / THREADS;
-
-  static shared double a;
+  int k, r, c, t;
+  int n = local_size*THREADS;
 
+  shared double *A = (shared double *)upc_all_alloc(THREADS, (size_t)local_size*n * sizeof(double));
   shared double *x = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
   shared double *y = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
-
-  if(x == NULL || y == NULL){
-	if (MYTHREAD == 0) printf("Out Of Memory: could not allocate space for the two arrays.\n");
-    return 0;
+  double *xp = (double *)malloc(n * sizeof(double));
+  shared double *tgath = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+  shared double *tmult = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  /* xp is private, so every thread must hear of a failure before any returns */
+  if(any_thread(x == NULL || y == NULL || A == NULL || xp == NULL || tgath == NULL || tmult == NULL)){
+    if (MYTHREAD==0){
+      printf("Out Of Memory: could not allocate space for the row-block vectors and matrix.\n");
+      upc_free(x);
+      upc_free(y);
+      upc_free(A);
+      upc_free(tgath);
+      upc_free(tmult);
+    }
+    free(xp);
+    return 0.0;
   }
 
-  if(MYTHREAD==0){
+  struct timespec start, mid, done, end;
+  double seconds;
 
-    a = VNI;
+  /* this thread's rows, and its elements of x and y, are contiguous in its local memory */
+  double *la = (double *)&A[MYTHREAD];
+  double *lx = (double *)&x[MYTHREAD];
+  double *ly = (double *)&y[MYTHREAD];
+  int i0 = MYTHREAD*local_size;
 
-    /* fill x and y vectors with random ints */
-    for(i=0; i<size; i++){
-      x[i] = VNI;
-      y[i] = VNI;
+  /* fill with the same values as the cyclic layout, each thread its own rows */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  for(k=0; k<local_size; k++){
+    lx[k] = rand_double(1, i0 + k);
+  }
+  for(r=0; r<local_size; r++){
+    for(c=0; c<n; c++){
+      la[(size_t)r*n + c] = rand_double(2, (unsigned long)(i0 + r)*n + c);
     }
-
   }
-
-  struct timespec start, end;
-
-  /* measuring upc_forall and upc_barrier overheads */
-  upc_loop_timer_nop(local_size);
-  upc_barrier_timer();
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   upc_barrier;
 
   clock_gettime(CLOCK, &start);
 
-  upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
-    y[i] = a * x[i] + y[i];
+  /* gather x, starting from the next thread so that they do not all read from the same one */
+  for(k=1; k<=THREADS; k++){
+    t = (MYTHREAD + k) % THREADS;
+    upc_memget(xp + (size_t)t*local_size, &x[t], local_size * sizeof(double));
   }
 
+  clock_gettime(CLOCK, &mid);
+
+  /* perform matrix-vector product on the local rows */
+  gemv_double(la, xp, ly, local_size, n);
+
+  clock_gettime(CLOCK, &done);
+  gather_times(tgath, tmult, start, mid, done);
+
   upc_barrier;
 
   clock_gettime(CLOCK, &end);
 
+  seconds = elapsed_seconds(start, end);
+
   if (MYTHREAD==0){
-	elapsed_time_hr(start, end, "Double AXPY.");
+    elapsed_time_hr(start, end, "Double Dense Matrix-Vector product (private).");
+    gather_summary(tgath, tmult);
+    dmatvec_summary(n, sizeof(double), seconds);
 
-    /* print some of the result so compiler does not throw it away */
-    printf("APXY result = %f\n", y[0]);
+    /* print result so compiler does not throw it away */
+    printf("Result vector y[0] = %f\n", y[0]);
+  }
+
+  free(xp);
 
+  upc_barrier;
+
+  if (MYTHREAD==0){
     upc_free(x);
     upc_free(y);
+    upc_free(A);
+    upc_free(tgath);
+    upc_free(tmult);
   }
-  return 0;
+
+  return seconds;
 }
 
 /*
@@ -834,13 +2638,19 @@ int double_axpy(unsigned int size){
  *         in matrix specified as number of ints
  *
  */
-int int_dmatvec_product(unsigned int size){
+int int_dmatvec_product(unsigned int size, bench_opts *opts){
 
   int i,j;
-  int r1,r2;
   int local_size = size/THREADS;
   int mat_size = pow(local_size*THREADS, 2);
   printf("local size: %ld, matrix size: %ld\n", local_size, mat_size);
+  double t_shared = 0.0, t_private = 0.0;
+
+  /* the private variant keeps its own row-block copies of the operands */
+  if (!RUN_SHARED(opts)){
+    int_dmatvec_rows(local_size);
+    return 0;
+  }
 
   /* create two vectors */
   shared int *x = (shared int *)upc_all_alloc(THREADS, local_size * sizeof(int));
@@ -858,22 +2668,17 @@ int int_dmatvec_product(unsigned int size){
 
   struct timespec start, end;
 
-  r1 = KISS;
-  r2 = KISS;
-  
-  if(MYTHREAD==0){
-    /* fill vector x and matrix A with random integer values */
-    for(i=0; i<local_size*THREADS; i++){
-      x[i] = r1;
-    }
-    for(i=0; i<mat_size; i++){
-      A[i] = r2;
-      /* if(i>=536872378){ */
-      /* 	printf("size of A[%d] = %d\n", i, sizeof(A[i])); */
-      /* 	printf("thread affinity A[%d]= %d\n", i, upc_threadof(&A[i])); */
-      /* } */
-    }
+  /* fill vector x and matrix A with random ints and clear y, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_int(x, local_size*THREADS, 1);
+  fill_int(A, mat_size, 2);
+  upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
+    y[i] = 0;
   }
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
@@ -894,8 +2699,11 @@ int int_dmatvec_product(unsigned int size){
 
   clock_gettime(CLOCK, &end);
 
+  t_shared = elapsed_seconds(start, end);
+
   if (MYTHREAD==0){
     elapsed_time_hr(start, end, "Integer Dense Matrix-Vector product.");
+    dmatvec_summary(local_size*THREADS, sizeof(int), t_shared);
 
     /* print result so compiler does not throw it away */
     printf("Result vector y[0] = %d\n", y[0]);
@@ -904,6 +2712,12 @@ int int_dmatvec_product(unsigned int size){
     upc_free(y);
     upc_free(A);
   }
+
+  if (RUN_PRIVATE(opts)){
+    t_private = int_dmatvec_rows(local_size);
+    if (MYTHREAD==0) variant_summary("Integer Dense Matrix-Vector product.", t_shared, t_private);
+  }
+
   return 0;
 
 }
@@ -918,12 +2732,18 @@ int int_dmatvec_product(unsigned int size){
  *         in matrix specified as number of floats
  *
  */
-int float_dmatvec_product(unsigned int size){
+int float_dmatvec_product(unsigned int size, bench_opts *opts){
 
   int i,j;
-  float r1,r2;
   int local_size = size/THREADS;
   int mat_size = pow(local_size*THREADS, 2);
+  double t_shared = 0.0, t_private = 0.0;
+
+  /* the private variant keeps its own row-block copies of the operands */
+  if (!RUN_SHARED(opts)){
+    float_dmatvec_rows(local_size);
+    return 0;
+  }
 
   /* create two vectors */
   shared float *x = (shared float *)upc_all_alloc(THREADS, local_size * sizeof(float));
@@ -939,18 +2759,17 @@ int float_dmatvec_product(unsigned int size){
 
   struct timespec start, end;
 
-  r1 = UNI;
-  r2 = UNI;
-
-  if(MYTHREAD==0){
-    /* fill vector x and matrix A with random integer values */
-    for(i=0; i<local_size*THREADS; i++){
-      x[i] = r1;
-    }
-    for(i=0; i<mat_size; i++){
-      A[i] = r2;
-    }
+  /* fill vector x and matrix A with random floats and clear y, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_float(x, local_size*THREADS, 1);
+  fill_float(A, mat_size, 2);
+  upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
+    y[i] = 0;
   }
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
@@ -971,8 +2790,11 @@ int float_dmatvec_product(unsigned int size){
 
   clock_gettime(CLOCK, &end);
 
+  t_shared = elapsed_seconds(start, end);
+
   if (MYTHREAD==0){
 	elapsed_time_hr(start, end, "Float Dense Matrix-Vector product.");
+    dmatvec_summary(local_size*THREADS, sizeof(float), t_shared);
 
     /* print result so compiler does not throw it away */
     printf("Result vector y[0] = %f\n", y[0]);
@@ -983,6 +2805,11 @@ int float_dmatvec_product(unsigned int size){
 
   }
 
+  if (RUN_PRIVATE(opts)){
+    t_private = float_dmatvec_rows(local_size);
+    if (MYTHREAD==0) variant_summary("Float Dense Matrix-Vector product.", t_shared, t_private);
+  }
+
   return 0;
 
 }
@@ -997,12 +2824,18 @@ int float_dmatvec_product(unsigned int size){
  *         in matrix specified as number of floats
  *
  */
-int double_dmatvec_product(unsigned int size){
+int double_dmatvec_product(unsigned int size, bench_opts *opts){
 
   int i,j;
-  double r1,r2;
   int local_size = size/THREADS;
   int mat_size = pow(local_size*THREADS, 2);
+  double t_shared = 0.0, t_private = 0.0;
+
+  /* the private variant keeps its own row-block copies of the operands */
+  if (!RUN_SHARED(opts)){
+    double_dmatvec_rows(local_size);
+    return 0;
+  }
 
   /* create two vectors */
   shared double *x = (shared double *)upc_all_alloc(THREADS, local_size * sizeof(double));
@@ -1020,18 +2853,17 @@ int double_dmatvec_product(unsigned int size){
 
   struct timespec start, end;
 
-  r1 = VNI;
-  r2 = VNI;
-
-  if(MYTHREAD==0){
-    /* fill vector x and matrix A with random integer values */
-    for(i=0; i<local_size*THREADS; i++){
-      x[i] = r1;
-    }
-    for(i=0; i<mat_size; i++){
-      A[i] = r2;
-    }
+  /* fill vector x and matrix A with random doubles and clear y, each thread its own elements */
+  upc_barrier;
+  clock_gettime(CLOCK, &start);
+  fill_double(x, local_size*THREADS, 1);
+  fill_double(A, mat_size, 2);
+  upc_forall(i=0; i<local_size*THREADS; i++; &y[i]){
+    y[i] = 0;
   }
+  upc_barrier;
+  clock_gettime(CLOCK, &end);
+  if (MYTHREAD == 0) setup_summary(start, end);
 
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(local_size);
@@ -1052,8 +2884,11 @@ int double_dmatvec_product(unsigned int size){
 
   clock_gettime(CLOCK, &end);
 
+  t_shared = elapsed_seconds(start, end);
+
   if (MYTHREAD==0){
-	elapsed_time_hr(start, end, "Dense Matrix-Vector product.");
+	elapsed_time_hr(start, end, "Double Dense Matrix-Vector product.");
+    dmatvec_summary(local_size*THREADS, sizeof(double), t_shared);
 
     /* print result so compiler does not throw it away */
     printf("Result vector y[0] = %f\n", y[0]);
@@ -1063,6 +2898,11 @@ int double_dmatvec_product(unsigned int size){
     upc_free(A);
   }
 
+  if (RUN_PRIVATE(opts)){
+    t_private = double_dmatvec_rows(local_size);
+    if (MYTHREAD==0) variant_summary("Double Dense Matrix-Vector product.", t_shared, t_private);
+  }
+
   return 0;
 
 }
@@ -21,58 +21,101 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #include "level1.h"
+#include "stencil.h"
 
 
 /* Level 1 benchmark driver - calls appropriate function */
 /* based on command line arguments.                      */
-void bench_level1(char *b, unsigned int s, unsigned long r, char *o, char *dt ){
+void bench_level1(char *b, unsigned int s, unsigned long r, char *o, char *dt, bench_opts *opts){
 
   /* BLAS operations */
   if(strcmp(b, "blas_op") == 0){
 
-    if(strcmp(o, "dot_product") == 0){
+    /* the BLAS kernels index through shared pointers unless told otherwise */
+    if(opts->variant == NULL) opts->variant = "shared";
+    if(dt == NULL) dt = "int";
 
-      if(strcmp(dt, "int") == 0) int_dot_product(s);
-      else if(strcmp(dt, "float") == 0) float_dot_product(s);
-      else if(strcmp(dt, "double") == 0) double_dot_product(s);
+    if(strcmp(opts->variant, "shared") != 0 && strcmp(opts->variant, "private") != 0 && !RUN_BOTH(opts)){
+      fprintf(stderr, "ERROR: check you are using a valid variant, shared, private or both...\n");
+    }
+
+    else if(strcmp(opts->layout, "cyclic") != 0 && strcmp(opts->layout, "blocked") != 0){
+      fprintf(stderr, "ERROR: check you are using a valid layout, cyclic or blocked...\n");
+    }
+
+#ifdef BLAS_BLOCK
+    /* a static block size only fits the vector length it was built for */
+    else if(LAYOUT_BLOCKED(opts) && s / THREADS != BLAS_BLOCK){
+      fprintf(stderr, "ERROR: this build has blocks of %d elements, use --size %d...\n", BLAS_BLOCK, BLAS_SIZE);
+    }
+#endif
+
+    else if(strcmp(o, "dot_product") == 0){
+
+      if(strcmp(dt, "int") == 0) int_dot_product(s, opts);
+      else if(strcmp(dt, "float") == 0) float_dot_product(s, opts);
+      else if(strcmp(dt, "double") == 0) double_dot_product(s, opts);
       else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
 
     }
 
     else if(strcmp(o, "scalar_mult") == 0){
 
-      if(strcmp(dt, "int") == 0) int_scalar_mult(s);
-      else if(strcmp(dt, "float") == 0) float_scalar_mult(s);
-      else if(strcmp(dt, "double") == 0) double_scalar_mult(s);
+      if(strcmp(dt, "int") == 0) int_scalar_mult(s, opts);
+      else if(strcmp(dt, "float") == 0) float_scalar_mult(s, opts);
+      else if(strcmp(dt, "double") == 0) double_scalar_mult(s, opts);
       else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
 
     }
 
     else if(strcmp(o, "norm") == 0){
 
-      if(strcmp(dt, "int") == 0) int_norm(s);
-      else if(strcmp(dt, "float") == 0) float_norm(s);
-      else if(strcmp(dt, "double") == 0) double_norm(s);
+      if(strcmp(dt, "int") == 0) int_norm(s, opts);
+      else if(strcmp(dt, "float") == 0) float_norm(s, opts);
+      else if(strcmp(dt, "double") == 0) double_norm(s, opts);
       else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
 
     }
 
     else if(strcmp(o, "axpy") == 0){
 
-      if(strcmp(dt, "int") == 0) int_axpy(s);
-      else if(strcmp(dt, "float") == 0) float_axpy(s);
-      else if(strcmp(dt, "double") == 0) double_axpy(s);
+      if(strcmp(dt, "int") == 0) int_axpy(s, opts);
+      else if(strcmp(dt, "float") == 0) float_axpy(s, opts);
+      else if(strcmp(dt, "double") == 0) double_axpy(s, opts);
       else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
 
     }
 
+    /* fused kernels, compared with the separate ones they replace */
+    else if(strcmp(o, "axpy_dot") == 0){
+
+      if(strcmp(dt, "double") == 0) double_axpy_dot(s, opts);
+      else fprintf(stderr, "ERROR: the fused kernels are double only, use -d double...\n");
+
+    }
+
+    else if(strcmp(o, "scal_norm") == 0){
+
+      if(strcmp(dt, "double") == 0) double_scal_norm(s, opts);
+      else fprintf(stderr, "ERROR: the fused kernels are double only, use -d double...\n");
+
+    }
+
+    else if(strcmp(o, "waxpby") == 0){
+
+      if(strcmp(dt, "double") == 0) double_waxpby(s, opts);
+      else fprintf(stderr, "ERROR: the fused kernels are double only, use -d double...\n");
+
+    }
+
     else if(strcmp(o, "dmatvec_product") == 0){
 
-      if(strcmp(dt, "int") == 0) int_dmatvec_product(s);
-      else if(strcmp(dt, "float") == 0) float_dmatvec_product(s);
-      else if(strcmp(dt, "double") == 0) double_dmatvec_product(s);
+      if(strcmp(dt, "int") == 0) int_dmatvec_product(s, opts);
+      else if(strcmp(dt, "float") == 0) float_dmatvec_product(s, opts);
+      else if(strcmp(dt, "double") == 0) double_dmatvec_product(s, opts);
       else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
 
     }
@@ -87,18 +130,185 @@ void bench_level1(char *b, unsigned int s, unsigned long r, char *o, char *dt ){
       
       double_spgemm(r);
     }
+    else if(strcmp(o, "dgemm") == 0){
+
+      double_gemm(s, opts);
+    }
+    else if(strcmp(o, "sgemm") == 0){
+
+      float_gemm(s, opts);
+    }
     
   }
 
   /* Stencil codes */
   else if (strcmp(b, "stencil") == 0){
 
-    /* o is set to "dot_product" by default. Use this to check for a default */
-    if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil27(s);
-    else if(strcmp(o, "19") == 0) stencil19(s);
-    else if(strcmp(o, "9") == 0) stencil9(s);
-    else if(strcmp(o, "5") == 0) stencil5(s);
-    else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+    /* the slab stencils run on private pointers unless told otherwise, the cyclic ones on shared only */
+    if(opts->variant == NULL) opts->variant = (strcmp(opts->mode, "cyclic") == 0) ? "shared" : "private";
+
+    /* the stencils run in double precision unless told otherwise */
+    opts->dtype = (dt == NULL) ? "double" : dt;
+
+    /* and for REPS sweeps unless --reps is given */
+    opts->reps = (r == ULONG_MAX) ? REPS : (r > INT_MAX) ? INT_MAX : (int)r;
+
+    if(opts->reps < 1){
+      fprintf(stderr, "ERROR: the stencils need at least one sweep...\n");
+    }
+
+    else if(strcmp(opts->variant, "shared") != 0 && strcmp(opts->variant, "private") != 0 && !RUN_BOTH(opts)){
+      fprintf(stderr, "ERROR: check you are using a valid variant, shared, private or both...\n");
+    }
+
+    else if(strcmp(opts->mode, "cyclic") == 0 && strcmp(opts->variant, "shared") != 0){
+      fprintf(stderr, "ERROR: the cyclic stencils run through shared pointers only, use --mode slab for --variant %s...\n", opts->variant);
+    }
+
+    else if(strcmp(opts->mode, "cyclic") == 0 && strcmp(opts->dtype, "double") != 0){
+      fprintf(stderr, "ERROR: the cyclic stencils are double only, use --mode slab for %s...\n", opts->dtype);
+    }
+
+    else if(strcmp(opts->coef, "const") != 0 && (strcmp(opts->coef, "var") != 0 || strcmp(opts->mode, "slab") != 0)){
+      fprintf(stderr, "ERROR: use --coef const, or --coef var in slab mode...\n");
+    }
+
+    else if(strcmp(opts->sync, "barrier") != 0 && strcmp(opts->mode, "slab") != 0 && strcmp(opts->mode, "mixed") != 0 && strcmp(opts->mode, "jit") != 0){
+      fprintf(stderr, "ERROR: --sync %s is available in slab, mixed and jit modes only...\n", opts->sync);
+    }
+
+    else if(opts->tol > 0.0 && strcmp(opts->mode, "slab") != 0){
+      fprintf(stderr, "ERROR: --tol runs to a tolerance in slab mode only...\n");
+    }
+
+    else if(strcmp(opts->sync, "both") == 0 && strcmp(opts->mode, "slab") != 0){
+      fprintf(stderr, "ERROR: --sync both compares the two in slab mode only, use barrier or p2p...\n");
+    }
+
+    else if(strcmp(opts->mode, "cyclic") == 0 && strcmp(opts->bc, "fixed") != 0){
+      fprintf(stderr, "ERROR: the cyclic stencils have a fixed boundary only, use --mode slab or cube for %s...\n", opts->bc);
+    }
+
+    else if(strcmp(opts->mode, "cyclic") == 0){
+
+      /* o is set to "dot_product" by default. Use this to check for a default */
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil27(s, opts->reps);
+      else if(strcmp(o, "19") == 0) stencil19(s, opts->reps);
+      else if(strcmp(o, "9") == 0) stencil9(s, opts->reps);
+      else if(strcmp(o, "5") == 0) stencil5(s, opts->reps);
+      else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "slab") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_slab(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_slab(s, 19, opts);
+      else if(strcmp(o, "9") == 0) stencil_slab(s, 9, opts);
+      else if(strcmp(o, "5") == 0) stencil_slab(s, 5, opts);
+      else if(strcmp(o, "star3d") == 0) stencil_star(s, 3, opts);
+      else if(strcmp(o, "star2d") == 0) stencil_star(s, 2, opts);
+      else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "temporal") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_temporal(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_temporal(s, 19, opts);
+      else if(strcmp(o, "star3d") == 0) stencil_star(s, 3, opts);
+      else if(strcmp(o, "star2d") == 0) stencil_star(s, 2, opts);
+      else fprintf(stderr, "ERROR: temporal mode supports the 27, 19, star3d and star2d stencils only...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "cube") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_cube(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_cube(s, 19, opts);
+      else fprintf(stderr, "ERROR: cube mode supports the 27 and 19 point stencils only...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "stream") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_stream(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_stream(s, 19, opts);
+      else if(strcmp(o, "9") == 0) stencil_stream(s, 9, opts);
+      else if(strcmp(o, "5") == 0) stencil_stream(s, 5, opts);
+      else if(strcmp(o, "star3d") == 0) stencil_star(s, 3, opts);
+      else if(strcmp(o, "star2d") == 0) stencil_star(s, 2, opts);
+      else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "mixed") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_mixed(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_mixed(s, 19, opts);
+      else fprintf(stderr, "ERROR: mixed mode supports the 27 and 19 point stencils only...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "jit") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_jit(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_jit(s, 19, opts);
+      else if(strcmp(o, "9") == 0) stencil_jit(s, 9, opts);
+      else if(strcmp(o, "5") == 0) stencil_jit(s, 5, opts);
+      else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "gs") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_gs(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_gs(s, 19, opts);
+      else if(strcmp(o, "9") == 0) stencil_gs(s, 9, opts);
+      else if(strcmp(o, "5") == 0) stencil_gs(s, 5, opts);
+      else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+
+    }
+
+    else if(strcmp(opts->mode, "overlap") == 0){
+
+      if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_overlap(s, 27, opts);
+      else if(strcmp(o, "19") == 0) stencil_overlap(s, 19, opts);
+      else if(strcmp(o, "9") == 0) stencil_overlap(s, 9, opts);
+      else if(strcmp(o, "5") == 0) stencil_overlap(s, 5, opts);
+      else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+
+    }
+
+    else fprintf(stderr, "ERROR: check you are using a valid stencil mode...\n");
+
+  }
+
+  /* Multigrid V-cycles over the 27 and 5 point operators */
+  else if (strcmp(b, "multigrid") == 0){
+
+    /* MG_CYCLES V-cycles unless --reps is given */
+    opts->reps = (r == ULONG_MAX) ? MG_CYCLES : (r > INT_MAX) ? INT_MAX : (int)r;
+
+    if(opts->reps < 1){
+      fprintf(stderr, "ERROR: multigrid needs at least one cycle...\n");
+    }
+
+    else if(dt != NULL && strcmp(dt, "double") != 0){
+      fprintf(stderr, "ERROR: multigrid is double only...\n");
+    }
+
+    else if(strcmp(opts->bc, "fixed") != 0){
+      fprintf(stderr, "ERROR: multigrid has a fixed boundary only...\n");
+    }
+
+    else if(opts->tol > 0.0){
+      fprintf(stderr, "ERROR: multigrid runs a fixed number of cycles, --tol is for the slab stencils...\n");
+    }
+
+    else if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0) stencil_multigrid(s, 27, opts);
+    else if(strcmp(o, "5") == 0) stencil_multigrid(s, 5, opts);
+    else fprintf(stderr, "ERROR: multigrid supports the 27 and 5 point stencils only...\n");
 
   }
 
@@ -18,61 +18,95 @@
 /* See the License for the specific language governing permissions and */
 /* limitations under the License. */
 
-void bench_level1(char *, unsigned int, unsigned long, char *, char *);
+/* Runtime options that select between kernel implementations */
+typedef struct {
+  char *mode;   /* stencil execution mode: "cyclic", "slab", "temporal", "overlap", "cube", "stream", "gs", "mixed" or "jit" */
+  char *variant; /* kernel addressing: "shared", "private" or "both" */
+  char *dtype;   /* element type of the stencil grids */
+  char *pgrid;   /* thread grid "PXxPYxPZ" in cube mode or "PxQ" for dgemm and sgemm, NULL to choose one */
+  char *tile;    /* j x k tile sizes "TJxTK[,TJxTK...]" of the slab sweeps */
+  char *bc;      /* boundary condition of the stencil grids */
+  char *coef;    /* "const" or "var": coefficients of the 27 and 19 point slab stencils */
+  char *sync;    /* "barrier", "p2p" or "both": synchronisation of the slab sweeps */
+  char *layout;  /* "cyclic" or "blocked": element order of the BLAS-1 vectors in the shared variants */
+  int tblock;   /* time steps fused per pass in temporal mode */
+  int tdepth;   /* planes per tile in temporal mode */
+  int radius;   /* radius of the star2d and star3d stencils */
+  int reps;     /* sweeps per stencil run */
+  double tol;   /* residual reduction to run the slab stencils to, 0 for a fixed count */
+  int maxiter;  /* most sweeps of a run to a tolerance */
+  int rcheck;   /* sweeps between global residual reductions */
+} bench_opts;
+
+/* Which implementations of a kernel to run for the selected variant */
+#define RUN_SHARED(o)  (strcmp((o)->variant, "private") != 0)
+#define RUN_PRIVATE(o) (strcmp((o)->variant, "shared") != 0)
+#define RUN_BOTH(o)    (strcmp((o)->variant, "both") == 0)
+
+/* Whether the shared variants index the BLAS-1 vectors in blocks of size/THREADS */
+#define LAYOUT_BLOCKED(o) (strcmp((o)->layout, "blocked") == 0)
 
-int int_dot_product(unsigned int);
-int float_dot_product(unsigned int);
-int double_dot_product(unsigned int);
-
-int int_scalar_mult(unsigned int);
-int float_scalar_mult(unsigned int);
-int double_scalar_mult(unsigned int);
-
-int int_norm(unsigned int);
-int float_norm(unsigned int);
-int double_norm(unsigned int);
+/*
+ * Pointer to this thread's slice of a blocked vector v of T, allocated
+ * as upc_all_alloc(THREADS, local_size*sizeof(T)), so that every thread
+ * holds one block.  In a static THREADS build with the vector length
+ * fixed by BLAS_SIZE the block size is a constant and the pointer has
+ * the layout in its type; otherwise it is an indefinite-block pointer to
+ * the start of the local block.  The blocked shared variants of the
+ * kernels walk their slice through these pointers-to-shared.
+ */
+#if defined(__UPC_STATIC_THREADS__) && defined(BLAS_SIZE)
+#define BLAS_BLOCK (BLAS_SIZE / THREADS)
+#define BLOCK_PTR(T) shared [BLAS_BLOCK] T *
+#define BLOCK_OF(T, v) ((shared [BLAS_BLOCK] T *)(v) + MYTHREAD*BLAS_BLOCK)
+#else
+#define BLOCK_PTR(T) shared [] T *
+#define BLOCK_OF(T, v) ((shared [] T *)&(v)[MYTHREAD])
+#endif
 
-int int_axpy(unsigned int);
-int float_axpy(unsigned int);
-int double_axpy(unsigned int);
+void bench_level1(char *, unsigned int, unsigned long, char *, char *, bench_opts *);
 
-int int_dmatvec_product(unsigned int);
-int float_dmatvec_product(unsigned int);
-int double_dmatvec_product(unsigned int);
+int int_dot_product(unsigned int, bench_opts *);
+int float_dot_product(unsigned int, bench_opts *);
+int double_dot_product(unsigned int, bench_opts *);
 
-int float_spmatvec_product(unsigned long);
-int double_spmatvec_product(unsigned long);
-int double_spgemm(unsigned long);
+int int_scalar_mult(unsigned int, bench_opts *);
+int float_scalar_mult(unsigned int, bench_opts *);
+int double_scalar_mult(unsigned int, bench_opts *);
 
-void stencil27(unsigned int);
-void stencil19(unsigned int);
-void stencil9(unsigned int);
-void stencil5(unsigned int);
+int int_norm(unsigned int, bench_opts *);
+int float_norm(unsigned int, bench_opts *);
+int double_norm(unsigned int, bench_opts *);
 
+int int_axpy(unsigned int, bench_opts *);
+int float_axpy(unsigned int, bench_opts *);
+int double_axpy(unsigned int, bench_opts *);
 
-/* Marsaglia's RNGs (fast on Odroid) */
-/*
- * See
- * http://www.cse.yorku.ca/~oz/marsaglia-rng.html
- */
+int double_axpy_dot(unsigned int, bench_opts *);
+int double_scal_norm(unsigned int, bench_opts *);
+int double_waxpby(unsigned int, bench_opts *);
 
-#define znew (z=36969*(z&65535)+(z>>16))
-#define wnew (w=18000*(w&65535)+(w>>16))
-#define MWC ((znew<<16)+wnew )
-#define SHR3 (jsr^=(jsr<<17), jsr^=(jsr>>13), jsr^=(jsr<<5))
-#define CONG (jcong=69069*jcong+1234567)
-#define FIB ((b=a+b),(a=b-a))
-#define KISS ((MWC^CONG)+SHR3)
-#define LFIB4 (c++,t[c]=t[c]+t[UC(c+58)]+t[UC(c+119)]+t[UC(c+178)])
-#define SWB (c++,bro=(x<y),t[c]=(x=t[UC(c+34)])-(y=t[UC(c+19)]+bro))
-#define UNI (KISS*2.328306e-10)
-#define VNI ((long) KISS)*4.656613e-10
-#define UC (unsigned char) /*a cast operation*/
-typedef unsigned long UL;
-/* Global static variables: */
-static UL z=362436069, w=521288629, jsr=123456789, jcong=380116160;
-static UL a=224466889, b=7584631, t[256];
-/* Use random seeds to reset z,w,jsr,jcong,a,b, and the table
-t[256]*/
-static UL x=0,y=0,bro; static unsigned char c=0;
+int int_dmatvec_product(unsigned int, bench_opts *);
+int float_dmatvec_product(unsigned int, bench_opts *);
+int double_dmatvec_product(unsigned int, bench_opts *);
 
+int float_spmatvec_product(unsigned long);
+int double_spmatvec_product(unsigned long);
+int double_spgemm(unsigned long);
+int double_gemm(unsigned int, bench_opts *);
+int float_gemm(unsigned int, bench_opts *);
+
+void stencil27(unsigned int, int);
+void stencil19(unsigned int, int);
+void stencil9(unsigned int, int);
+void stencil5(unsigned int, int);
+void stencil_slab(unsigned int, int, bench_opts *);
+void stencil_temporal(unsigned int, int, bench_opts *);
+void stencil_overlap(unsigned int, int, bench_opts *);
+void stencil_cube(unsigned int, int, bench_opts *);
+void stencil_star(unsigned int, int, bench_opts *);
+void stencil_stream(unsigned int, int, bench_opts *);
+void stencil_gs(unsigned int, int, bench_opts *);
+void stencil_mixed(unsigned int, int, bench_opts *);
+void stencil_multigrid(unsigned int, int, bench_opts *);
+void stencil_jit(unsigned int, int, bench_opts *);
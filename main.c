@@ -28,24 +28,35 @@
 
 void usage();
 
-void settable(UL i1,UL i2,UL i3,UL i4,UL i5, UL i6){
-  int i; z=i1;w=i2,jsr=i3; jcong=i4; a=i5; b=i6;
-  for(i=0;i<256;i=i+1) t[i]=KISS;
-}
-
+/* long-only options */
+enum { OPT_TBLOCK = 256, OPT_TDEPTH, OPT_PGRID, OPT_TILE, OPT_RADIUS, OPT_TOL, OPT_MAXITER, OPT_RCHECK, OPT_BC, OPT_COEF, OPT_SYNC, OPT_LAYOUT };
 
 int main(int argc, char **argv){
   
   int c;
 
-  /* Init RNG here */
-  settable(12345,65435,34221,12345,9983651,95746118);
-
     char *bench = "blas_op";
     unsigned int size = 200;
     unsigned long rep = ULONG_MAX;
     char *op  = "dot_product";
-    char *dt = "int";
+    char *dt = NULL;
+    bench_opts opts;
+
+    opts.mode = "cyclic";
+    opts.variant = NULL;
+    opts.dtype = NULL;
+    opts.pgrid = NULL;
+    opts.tile = NULL;
+    opts.bc = "fixed";
+    opts.coef = "const";
+    opts.sync = "barrier";
+    opts.layout = "cyclic";
+    opts.tblock = 4;
+    opts.tdepth = 8;
+    opts.radius = 2;
+    opts.tol = 0.0;
+    opts.maxiter = 10000;
+    opts.rcheck = 10;
     
     static struct option option_list[] =
     { {"bench", required_argument, NULL, 'b'},
@@ -53,13 +64,27 @@ int main(int argc, char **argv){
       {"reps", required_argument, NULL, 'r'},
       {"op", required_argument, NULL, 'o'},
       {"dtype", required_argument, NULL, 'd'},
+      {"mode", required_argument, NULL, 'm'},
+      {"variant", required_argument, NULL, 'v'},
+      {"tblock", required_argument, NULL, OPT_TBLOCK},
+      {"tdepth", required_argument, NULL, OPT_TDEPTH},
+      {"pgrid", required_argument, NULL, OPT_PGRID},
+      {"tile", required_argument, NULL, OPT_TILE},
+      {"radius", required_argument, NULL, OPT_RADIUS},
+      {"tol", required_argument, NULL, OPT_TOL},
+      {"maxiter", required_argument, NULL, OPT_MAXITER},
+      {"rcheck", required_argument, NULL, OPT_RCHECK},
+      {"bc", required_argument, NULL, OPT_BC},
+      {"coef", required_argument, NULL, OPT_COEF},
+      {"sync", required_argument, NULL, OPT_SYNC},
+      {"layout", required_argument, NULL, OPT_LAYOUT},
       {"help", no_argument, NULL, 'h'},
       {0, 0, 0, 0}
     };
 
     if (MYTHREAD == 0) printf("Executing benchmark on %d UPC threads.\n", THREADS);
     
-    while((c = getopt_long(argc, argv, "b:s:r:o:d:h", option_list, NULL)) != -1){
+    while((c = getopt_long(argc, argv, "b:s:r:o:d:m:v:h", option_list, NULL)) != -1){
       switch(c){
         case 'b':
           bench = optarg;
@@ -81,6 +106,62 @@ int main(int argc, char **argv){
           dt = optarg;
           if (MYTHREAD==0) printf("Data type is %s\n", dt);
           break;
+        case 'm':
+          opts.mode = optarg;
+          if (MYTHREAD==0) printf("Stencil mode is %s\n", opts.mode);
+          break;
+        case 'v':
+          opts.variant = optarg;
+          if (MYTHREAD==0) printf("Kernel variant is %s\n", opts.variant);
+          break;
+        case OPT_TBLOCK:
+          opts.tblock = atoi(optarg);
+          if (MYTHREAD==0) printf("Time steps per block %d\n", opts.tblock);
+          break;
+        case OPT_TDEPTH:
+          opts.tdepth = atoi(optarg);
+          if (MYTHREAD==0) printf("Planes per tile %d\n", opts.tdepth);
+          break;
+        case OPT_PGRID:
+          opts.pgrid = optarg;
+          if (MYTHREAD==0) printf("Thread grid %s\n", opts.pgrid);
+          break;
+        case OPT_TILE:
+          opts.tile = optarg;
+          if (MYTHREAD==0) printf("Tile sizes %s\n", opts.tile);
+          break;
+        case OPT_RADIUS:
+          opts.radius = atoi(optarg);
+          if (MYTHREAD==0) printf("Star stencil radius %d\n", opts.radius);
+          break;
+        case OPT_TOL:
+          opts.tol = atof(optarg);
+          if (MYTHREAD==0) printf("Residual tolerance %e\n", opts.tol);
+          break;
+        case OPT_MAXITER:
+          opts.maxiter = atoi(optarg);
+          if (MYTHREAD==0) printf("Iteration cap %d\n", opts.maxiter);
+          break;
+        case OPT_RCHECK:
+          opts.rcheck = atoi(optarg);
+          if (MYTHREAD==0) printf("Iterations between residual reductions %d\n", opts.rcheck);
+          break;
+        case OPT_BC:
+          opts.bc = optarg;
+          if (MYTHREAD==0) printf("Boundary condition is %s\n", opts.bc);
+          break;
+        case OPT_COEF:
+          opts.coef = optarg;
+          if (MYTHREAD==0) printf("Coefficients are %s\n", opts.coef);
+          break;
+        case OPT_SYNC:
+          opts.sync = optarg;
+          if (MYTHREAD==0) printf("Synchronisation is %s\n", opts.sync);
+          break;
+        case OPT_LAYOUT:
+          opts.layout = optarg;
+          if (MYTHREAD==0) printf("Vector layout is %s\n", opts.layout);
+          break;
         case 'h':
           if (MYTHREAD==0) usage();
           return 0;
@@ -90,7 +171,7 @@ int main(int argc, char **argv){
       }
     }
     
-    bench_level1(bench, size, rep, op, dt);
+    bench_level1(bench, size, rep, op, dt, &opts);
     
   return 0;
   
@@ -98,13 +179,46 @@ int main(int argc, char **argv){
 
 void usage(){
   printf("Usage for UPC KERNEL benchmarks:\n\n");
-  printf("\t -b, --bench NAME \t name of the benchmark - possible values are blas_op and stencil.\n");
+  printf("\t -b, --bench NAME \t name of the benchmark - possible values are blas_op, stencil and multigrid.\n");
   printf("\t -s, --size N \t\t vector length. Default is 200.\n");
-  printf("\t -r, --reps N \t\t number of repetitions. Default value is ULONG_MAX.\n");
+  printf("\t -r, --reps N \t\t number of repetitions. Default value is ULONG_MAX, and 100 sweeps for the stencils.\n");
   printf("\t -o, --op TYPE \t\t TYPE of operation.\n");
-  printf("\t\t\t\t --> for blas_op benchmark: \"dot_product\", \"scalar_mult\", \"dmatvec_product\", \"norm\", \"axpy\", \"spmv\" and \"spgemm\". Default is \"dot_product\".\n");
-  printf("\t\t\t\t --> for stencil benchmark: \"27\", \"19\", \"9\" and \"5\". Default is \"27\".\n");
-  printf("\t -d, --dtype DATATYPE \t DATATYPE to be used - possible values are int, long, float, double. Default is int.\n");
+  printf("\t\t\t\t --> for blas_op benchmark: \"dot_product\", \"scalar_mult\", \"dmatvec_product\", \"norm\", \"axpy\", \"spmv\", \"spgemm\", the dense matrix-matrix \"dgemm\" and \"sgemm\", and the fused \"axpy_dot\", \"scal_norm\" and \"waxpby\" (double only). Default is \"dot_product\".\n");
+  printf("\t\t\t\t --> for stencil benchmark: \"27\", \"19\", \"9\" and \"5\", and the high-order \"star3d\" and \"star2d\" (slab, temporal and stream modes). Default is \"27\".\n");
+  printf("\t\t\t\t --> for multigrid benchmark: \"27\" (3D) and \"5\" (2D). Default is \"27\". The size less 2 must be odd to coarsen, e.g. 2^k+1, and --reps gives the number of V-cycles (default 10).\n");
+  printf("\t -d, --dtype DATATYPE \t DATATYPE to be used - possible values are int, long, float, double. Default is int for blas_op and double for stencil (int, float and double are available with the slab based stencil modes).\n");
+  printf("\t -m, --mode MODE \t stencil execution mode - possible values are cyclic, slab, temporal, overlap, cube, stream, gs, mixed and jit. Default is cyclic.\n");
+  printf("\t\t\t\t --> cyclic: default UPC distribution, neighbours accessed through shared pointers.\n");
+  printf("\t\t\t\t --> slab: contiguous block of planes (3D) or rows (2D) per thread with ghost planes.\n");
+  printf("\t\t\t\t --> temporal: slab layout advancing several time steps per pass over cache-sized tiles (\"27\", \"19\" and the star stencils, whose ghost region is then radius x tblock planes deep).\n");
+  printf("\t\t\t\t --> overlap: slab layout fetching ghost planes while the interior is computed.\n");
+  printf("\t\t\t\t --> stream: slab layout with a single grid, updated in place through a small ring of planes.\n");
+  printf("\t\t\t\t --> gs: slab layout with a single grid, updated in place by multicolour Gauss-Seidel and compared with Jacobi.\n");
+  printf("\t\t\t\t --> mixed: slab layout with float storage, summing in float, in double and with compensation, against a double reference (\"27\" and \"19\" only, --dtype is ignored).\n");
+  printf("\t\t\t\t --> jit: slab layout, comparing the generic sweep with one compiled at run time for the grid size and weight (cached in $SK_JIT_DIR, built with $SK_JIT_CC $SK_JIT_CFLAGS).\n");
+  printf("\t\t\t\t --> cube: sub-cube per thread on a 3D thread grid, with face, edge and corner ghosts (\"27\" and \"19\" only).\n");
+  printf("\t     --tblock N \t time steps fused per pass in temporal mode. Default is 4.\n");
+  printf("\t     --tdepth N \t planes per tile in temporal mode. Default is 8.\n");
+  printf("\t     --pgrid PXxPYxPZ \t thread grid in cube mode, e.g. 4x2x2. Default is the factorisation of THREADS with the least halo.\n");
+  printf("\t\t\t\t PxQ for dgemm and sgemm, e.g. 4x2. Default is the most nearly square factorisation of THREADS.\n");
+  printf("\t     --tile TJxTK[,...] \t j x k tile sizes of the 3D sweeps in slab mode, 0 for a whole plane. Several are run and compared in turn.\n");
+  printf("\t     --radius R \t radius of the star3d and star2d stencils, 1 to 4 (2R+1 points per axis). Default is 2.\n");
+  printf("\t     --tol X \t\t run the slab stencils (slab mode only) until the residual falls to X times its first value, with the residual fused into the sweep and then in a pass of its own.\n");
+  printf("\t     --bc TYPE \t\t boundary condition of the slab based and cube stencils (not temporal mode) - possible values are fixed, periodic and neumann. Default is fixed.\n");
+  printf("\t     --coef TYPE \t coefficients of the 27 and 19 point stencils in slab mode - const (one weight) or var (a weight per point for each class of neighbour). Default is const.\n");
+  printf("\t     --sync TYPE \t how the slab sweeps in slab, mixed and jit modes wait for their neighbours - possible values are barrier, p2p and both (slab mode only). Default is barrier.\n");
+  printf("\t\t\t\t --> barrier: a upc_barrier at the end of every sweep.\n");
+  printf("\t\t\t\t --> p2p: wait only for the neighbours whose planes are read, on their strict shared progress counters.\n");
+  printf("\t\t\t\t --> both: run both in slab mode and report them side by side.\n");
+  printf("\t     --maxiter N \t most iterations of a run with --tol. Default is 10000.\n");
+  printf("\t     --rcheck M \t iterations between global residual reductions with --tol. Default is 10.\n");
+  printf("\t -v, --variant TYPE \t how kernels address their data - possible values are shared, private and both.\n");
+  printf("\t\t\t\t --> shared: index through pointers-to-shared. Default for blas_op.\n");
+  printf("\t\t\t\t --> private: cast each thread's local block to a private pointer. Default for slab stencils.\n");
+  printf("\t\t\t\t --> both: run both and report them side by side (blas_op and slab stencils).\n");
+  printf("\t     --layout TYPE \t element order of the BLAS-1 vectors in the shared variant - possible values are cyclic and blocked. Default is cyclic.\n");
+  printf("\t\t\t\t --> cyclic: element i on thread i %% THREADS, indexed with upc_forall.\n");
+  printf("\t\t\t\t --> blocked: a contiguous slice of size/THREADS elements per thread, each thread sweeping its own.\n");
   printf("\t -h, --help \t\t Displays this help.\n");
   printf("\n\n");
 }
@@ -36,20 +36,78 @@
 
 #include "level1.h"
 #include "utils.h"
+#include "stencil.h"
 
-#define REPS 100
+/* whether global index idx of a size^dims grid is an interior point */
+static int cyclic_interior(long idx, unsigned int size, int dims){
 
-void stencil27(unsigned int size){
+  int d;
+
+  for (d = 0; d < dims; d++) {
+    if (idx % size == 0 || idx % size == size-1) return 0;
+    idx /= size;
+  }
+
+  return 1;
+}
+
+/*
+ * Zero both arrays (including halos) and fill the interior of a0, each
+ * thread setting the points it has affinity to from a generator keyed on
+ * their global index.  Returns the time taken up to the closing barrier.
+ */
+static double cyclic_fill(shared double *a0, shared double *a1, unsigned int size, int dims){
+
+  long idx, total = (dims == 3) ? (long)size*size*size : (long)size*size;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK, &start);
+
+  upc_forall (idx = 0; idx < total; idx++; &a0[idx]) {
+    a0[idx] = cyclic_interior(idx, size, dims) ? sk_init_value(SK_DOUBLE, idx) : 0.0;
+    a1[idx] = 0.0;
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  return elapsed_seconds(start, end);
+}
+
+/* checksum of the interior of a cyclic grid, valid on thread 0. Collective. */
+static double cyclic_checksum(shared double *a, unsigned int size, int dims){
+
+  long idx, total = (dims == 3) ? (long)size*size*size : (long)size*size;
+  long long sum = 0;
+  double max = 0.0, scale;
+
+  upc_forall (idx = 0; idx < total; idx++; &a[idx]) {
+    if (cyclic_interior(idx, size, dims) && fabs(a[idx]) > max) max = fabs(a[idx]);
+  }
+
+  scale = sk_checksum_scale(max, pow(size-2, dims));
+
+  upc_forall (idx = 0; idx < total; idx++; &a[idx]) {
+    if (cyclic_interior(idx, size, dims)) sum += sk_term(a[idx], scale);
+  }
+
+  return sk_checksum(sum, scale);
+}
+
+void stencil27(unsigned int size, int reps){
 
   int i, j, k, iter;
   int n = size-2;
   int size3d=size*size*size;
   int size2d=size*size;
   double fac = 1.0/26;
+  double t_setup, checksum;
   
   /* Work buffers, with halos */
   shared double *a0 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*size3d);
   shared double *a1 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*size3d);
+  shared double *tmp;
   
   if(a0==NULL||a1==NULL){
     /* Something went wrong in the memory allocation here, fail gracefully */
@@ -62,24 +120,13 @@ void stencil27(unsigned int size){
   
   struct timespec start, end;
   
-  /* zero all of array (including halos) */
-  upc_forall (i = 0; i < size3d; i++; &a0[i]) {
-    a0[i] = 0.0;
-  }
-  
-  /* use random numbers to fill interior */
-  for (i = 1; i < n+1; i++) {
-    for (j = 1; j < n+1; j++) {
-      for (k = 1; k < n+1; k++) {
-	a0[i*size2d+j*size+k] = (double) rand()/ (double)(1.0 + RAND_MAX);
-      }
-    }
-  }
+  /* zero both arrays and fill the interior with random numbers */
+  t_setup = cyclic_fill(a0, a1, size, 3);
   
   /* run main computation */
   clock_gettime(CLOCK, &start);
 
-  for (iter = 0; iter < REPS; iter++) {
+  for (iter = 0; iter < reps; iter++) {
     
     upc_forall (i = 1; i < n+1; i++; i) {
       for (j = 1; j < n+1; j++) {
@@ -105,22 +152,23 @@ void stencil27(unsigned int size){
         }
       }
     }
-    
-    upc_forall (i = 1; i < n+1; i++; i) {
-      for (j = 1; j < n+1; j++) {
-	for (k = 1; k < n+1; k++) {
-	  a0[i*size2d+j*size+k] = a1[i*size2d+j*size+k];
-	}
-      }
-    }
-    
+
     upc_barrier;
 
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = a0;
+    a0 = a1;
+    a1 = tmp;
+
   } /* end iteration loop */
   clock_gettime(CLOCK, &end);
 
+  checksum = cyclic_checksum(a0, size, 3);
+
   if (MYTHREAD == 0){
     elapsed_time_hr(start, end, "Stencil - 27 point");
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
     /* Free malloc'd memory to prevent leaks */
     upc_free(a0);
     upc_free(a1);
@@ -128,17 +176,19 @@ void stencil27(unsigned int size){
     
 }
 
-void stencil19(unsigned int size){
+void stencil19(unsigned int size, int reps){
 
   int i, j, k, iter;
   int n = size-2;
   int size3d = size*size*size;
   int size2d = size*size;
   double fac = 1.0/18;
+  double t_setup, checksum;
   
   /* Work buffers, with halos */
   shared double *a0 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*size3d);
   shared double *a1 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*size3d);
+  shared double *tmp;
 
   if(a0==NULL||a1==NULL){
     /* Something went wrong in the memory allocation here, fail gracefully */
@@ -150,20 +200,9 @@ void stencil19(unsigned int size){
   }
 
   struct timespec start,end;
-  /* zero all of array (including halos) */
-
-  upc_forall (i = 0; i < size3d; i++; &a0[i]) {
-    a0[i] = 0.0;
-  }
 
-  /* use random numbers to fill interior */
-  upc_forall (i = 1; i < n+1; i++; &a0[i]) {
-    for (j = 1; j < n+1; j++) {
-      for (k = 1; k < n+1; k++) {
-	a0[i*size2d+j*size+k] = (double) rand()/ (double)(1.0 + RAND_MAX);
-      }
-    }
-  }
+  /* zero both arrays and fill the interior with random numbers */
+  t_setup = cyclic_fill(a0, a1, size, 3);
   
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(n+1);
@@ -174,7 +213,7 @@ void stencil19(unsigned int size){
   /* run main computation */
 
   clock_gettime(CLOCK, &start);
-  for (iter = 0; iter < REPS; iter++) {
+  for (iter = 0; iter < reps; iter++) {
 
     upc_forall (i = 1; i < n+1; i++; i) {
       for (j = 1; j < n+1; j++) {
@@ -196,23 +235,24 @@ void stencil19(unsigned int size){
 	}
       }
     }
-      
-    upc_forall (i = 1; i < n+1; i++; i) {
-      for (j = 1; j < n+1; j++) {
-	for (k = 1; k < n+1; k++) {
-	  a0[i*size2d+j*size+k] = a1[i*size2d+j*size+k];
-	}
-      }
-    }
 
     upc_barrier;
+
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = a0;
+    a0 = a1;
+    a1 = tmp;
       
   } /* end iteration loop */
 
   clock_gettime(CLOCK, &end);
   
+  checksum = cyclic_checksum(a0, size, 3);
+
   if(MYTHREAD==0){
     elapsed_time_hr(start, end, "Stencil - 19 point");
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
   
     /* Free malloc'd memory to prevent leaks */
     upc_free(a0);
@@ -220,16 +260,18 @@ void stencil19(unsigned int size){
   }
 }
 
-void stencil9(unsigned int size){
+void stencil9(unsigned int size, int reps){
 
   int i, j, iter;
   int n = size-2;
   int array_size = size*size;
   double fac = 1.0/8;
+  double t_setup, checksum;
   
   /* Work buffers, with halos */
   shared double *a0 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*array_size);
   shared double *a1 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*array_size);
+  shared double *tmp;
   
   if(a0==NULL||a1==NULL){
     /* Something went wrong in the memory allocation here, fail gracefully */
@@ -241,17 +283,9 @@ void stencil9(unsigned int size){
   }
 
   struct timespec start,end;
-  /* zero all of array (including halos) */
-  upc_forall (i = 0; i < array_size; i++; &a0[i]) {
-    a0[i] = 0.0;
-  }
-  
-  /* use random numbers to fill interior */
-  upc_forall (i = 1; i < n+1; i++; &a0[i]) {
-    for (j = 1; j < n+1; j++) {
-      a0[i*size+j] = (double) rand()/ (double)(1.0 + RAND_MAX);
-    }
-  }
+
+  /* zero both arrays and fill the interior with random numbers */
+  t_setup = cyclic_fill(a0, a1, size, 2);
   
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(n+1);
@@ -261,7 +295,7 @@ void stencil9(unsigned int size){
 
   /* run main computation */
   clock_gettime(CLOCK, &start);
-  for (iter = 0; iter < REPS; iter++) {
+  for (iter = 0; iter < reps; iter++) {
 
     upc_forall (i = 1; i < n+1; i++; &a0[i*size+i]) {
       for (j = 1; j < n+1; j++) {
@@ -271,20 +305,24 @@ void stencil9(unsigned int size){
 			a0[(i+1)*size+(j-1)] + a0[(i+1)*size+(j+1)]) * fac;
       }
     }
-    upc_forall (i = 1; i < n+1; i++; &a0[i*size+i]) {
-      for (j = 1; j < n+1; j++) {
-	a0[i*size+j] = a1[i*size+j];
-      }
-    }
 
     upc_barrier;
 
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = a0;
+    a0 = a1;
+    a1 = tmp;
+
   } /* end iteration loop */
 
   clock_gettime(CLOCK, &end);
   
+  checksum = cyclic_checksum(a0, size, 2);
+
   if(MYTHREAD == 0){
     elapsed_time_hr(start, end, "Stencil - 9 point");
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
 
     /* Free malloc'd memory to prevent leaks */
     upc_free(a0);
@@ -294,16 +332,18 @@ void stencil9(unsigned int size){
 }
 
 
-void stencil5(unsigned int size){
+void stencil5(unsigned int size, int reps){
 
   int i, j, iter;
   int n = size-2;
   int array_size = size*size;
   double fac = 1.0/8;
+  double t_setup, checksum;
   
   /* Work buffers */
   shared double *a0 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*array_size);
   shared double *a1 = (shared double*)upc_all_alloc(THREADS, sizeof(double)*array_size);
+  shared double *tmp;
   
   if(a0==NULL||a1==NULL){
     /* Something went wrong in the memory allocation here, fail gracefully */
@@ -316,17 +356,8 @@ void stencil5(unsigned int size){
   
   struct timespec start,end;
   
-  /* zero all of array (including halos) */
-  upc_forall (i = 0; i < array_size; i++; &a0[i]) {
-    a0[i] = 0.0;
-  }
-  
-  /* use random numbers to fill interior */
-  upc_forall (i = 1; i < n+1; i++; &a0[i]) {
-    for (j = 1; j < n+1; j++){
-      a0[i*size+j] = (double) rand()/ (double)(1.0 + RAND_MAX);
-    }
-  }
+  /* zero both arrays and fill the interior with random numbers */
+  t_setup = cyclic_fill(a0, a1, size, 2);
   
   /* measuring upc_forall and upc_barrier overheads */
   upc_loop_timer_nop(n+1);
@@ -336,7 +367,7 @@ void stencil5(unsigned int size){
 
   /* run main computation */
   clock_gettime(CLOCK, &start);
-  for (iter = 0; iter < REPS; iter++) {
+  for (iter = 0; iter < reps; iter++) {
     
     upc_forall (i = 1; i < n+1; i++; &a1[i*size+i]) {
       for (j = 1; j < n+1; j++){
@@ -344,20 +375,23 @@ void stencil5(unsigned int size){
 			+ a0[(i-1)*size+j] + a0[(i+1)*size+j]) * fac;
       }
     }
- 
-    upc_forall(i = 1; i < n+1; i++; &a0[i*size+i]) {
-      for (j = 1; j < n+1; j++) {
-	a0[i*size+j] = a1[i*size+j];
-      }
-    }
-    
+
     upc_barrier;
+
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = a0;
+    a0 = a1;
+    a1 = tmp;
   }
   
   clock_gettime(CLOCK, &end);
 
+  checksum = cyclic_checksum(a0, size, 2);
+
   if(MYTHREAD == 0){
     elapsed_time_hr(start, end, "Stencil - 5 point");
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
     
     /* Free malloc'd memory to prevent leaks */
     upc_free(a0);
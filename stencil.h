@@ -0,0 +1,152 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+* This software was developed as part of the
+* EC FP7 funded project Adept (Project ID: 610490)
+* www.adept-project.eu
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include <stddef.h>
+
+#ifdef __UPC_NB__
+#include <upc_nb.h>
+#endif
+
+#define REPS 100
+
+/* V-cycles per multigrid run */
+#define MG_CYCLES 10
+
+/* largest radius of the high-order star stencils */
+#define SK_MAX_RADIUS 4
+
+/* element types of the slab stencils */
+typedef enum { SK_INT, SK_FLOAT, SK_DOUBLE } sk_type;
+
+/* how float grids sum the neighbours: in float, in double, or in float with compensation */
+typedef enum { SK_SUM_PLAIN, SK_SUM_WIDE, SK_SUM_KAHAN } sk_sum;
+
+/* boundary conditions: fixed zero halo, periodic, zero gradient */
+typedef enum { SK_FIXED, SK_PERIODIC, SK_NEUMANN } sk_bc;
+
+const char *sk_type_name(sk_type);
+const char *sk_bc_name(sk_bc);
+size_t sk_type_size(sk_type);
+double sk_get(sk_type, const void *, size_t);
+void sk_set(sk_type, void *, size_t, double);
+double sk_init_value(sk_type, unsigned long long);
+double sk_checksum_scale(double, double);
+long long sk_term(double, double);
+double sk_checksum(long long, double);
+void sk_sweep(sk_type, int, void *, void *, int, int, int, int, int, int, double, double *);
+double stencil_fac(int);
+
+/* sweep of planes [plo, phi) of a private block, specialised at run time */
+typedef void (*sk_jit_fn)(void *, const void *, int, int);
+
+/* A sweep compiled at run time for one stencil, type, size and weight */
+typedef struct {
+  void *handle;   /* the loaded shared object */
+  sk_jit_fn sweep;
+  int cached;     /* found in the cache rather than built */
+  double build;   /* seconds spent generating and compiling it */
+  double load;    /* seconds spent loading it */
+  char path[520]; /* the shared object */
+} sk_jit_t;
+
+int sk_jit_load(sk_jit_t *, sk_type, int, int, double);
+void sk_jit_close(sk_jit_t *);
+
+/* Pointer to the start of one thread's block, addressed in bytes */
+typedef shared [] char *slab_ptr;
+
+/* One slab-distributed grid */
+typedef struct {
+  shared slab_ptr *dir;   /* block base pointers, one per thread */
+  slab_ptr lo, hi;        /* blocks of the lower and upper neighbour */
+  slab_ptr own;           /* this thread's block */
+  void *mine;             /* private view of the same block */
+#ifdef __UPC_NB__
+  upc_handle_t get[2];    /* ghost plane transfers in flight */
+#endif
+} slab_buf_t;
+
+/*
+ * Slab decomposition of a stencil grid along its outermost (i) dimension.
+ *
+ * Each UPC thread owns a contiguous block of interior i-planes, stored in
+ * its own local memory between `ghost` planes on either side.  Local plane
+ * p of a block holds global plane i0 - ghost + p.
+ */
+typedef struct {
+  int size;       /* points per dimension, including the fixed halo */
+  int halo;       /* width of the fixed halo */
+  int n;          /* interior points per dimension (size - 2*halo) */
+  int dims;       /* 2 (row slabs) or 3 (plane slabs) */
+  size_t plane;   /* elements per i-plane */
+  int i0;         /* global index of the first plane owned by MYTHREAD */
+  int nloc;       /* number of planes owned by MYTHREAD */
+  int ghost;      /* ghost planes kept on each side of a block */
+  sk_type type;   /* element type */
+  size_t elem;    /* bytes per element */
+  int tj, tk;     /* rows and columns per tile of a 3D sweep, 0 for whole planes */
+  int star;       /* radius of a high-order star stencil, 0 for the compact ones */
+  int reps;       /* sweeps per run */
+  sk_bc bc;       /* boundary condition */
+  sk_sum sum;     /* summation of the mixed precision sweeps of float grids */
+  double w[SK_MAX_RADIUS+1];  /* weights of the star stencil */
+  int ncoef;      /* neighbour classes with a coefficient per point, 0 for a constant one */
+  slab_buf_t *coef;  /* their coefficient blocks, laid out like the grid */
+  sk_jit_fn jit;  /* private sweep specialised at run time, NULL for the generic one */
+  int p2p;        /* wait for the neighbours only at the end of a sweep, rather than at a barrier */
+} slab_t;
+
+/*
+ * Decomposition of a 3D stencil grid over a Px x Py x Pz grid of threads.
+ *
+ * Each thread owns a sub-cube of the interior, stored privately with one
+ * ghost layer on every side, and publishes the 26 boundary regions its
+ * neighbours need (faces, edges and corners) in slots of a send buffer
+ * in its local shared memory.
+ */
+typedef struct {
+  int size;       /* points per dimension, including the fixed halo */
+  int n;          /* interior points per dimension (size-2) */
+  int p[3];       /* threads along i, j and k */
+  int c[3];       /* coordinates of MYTHREAD in the thread grid */
+  int lo[3];      /* global index of the first owned point along each axis */
+  int len[3];     /* owned points along each axis */
+  int ext[3];     /* extents of the private block, ghosts included */
+  size_t slot;    /* elements per send buffer slot */
+  sk_type type;   /* element type */
+  size_t elem;    /* bytes per element */
+  sk_bc bc;       /* boundary condition */
+} cube_t;
+
+int slab_type(const char *, sk_type *);
+int slab_bc(const char *, sk_bc *);
+int slab_init(slab_t *, unsigned int, int, int, int, sk_type);
+int slab_count(const slab_t *, int);
+int slab_alloc(const slab_t *, slab_buf_t *);
+void slab_free(slab_buf_t *);
+void slab_exchange(const slab_t *, slab_buf_t *);
+void slab_exchange_start(const slab_t *, slab_buf_t *);
+void slab_exchange_end(const slab_t *, slab_buf_t *);
+double slab_checksum(const slab_t *, const void *);
+
+#endif
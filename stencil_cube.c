@@ -0,0 +1,464 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+ * This software was developed as part of the
+ * EC FP7 funded project Adept (Project ID: 610490)
+ * www.adept-project.eu
+ */
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * UPC Stencil benchmark - 3D thread grid decomposition
+ *
+ * THREADS is factored into a Px x Py x Pz grid and every thread owns a
+ * sub-cube of the interior.  Compared with slabs this keeps working when
+ * there are more threads than planes, and shrinks the halo each thread
+ * has to fetch from two full planes to the surface of its sub-cube.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <upc.h>
+
+#include "level1.h"
+#include "utils.h"
+#include "stencil.h"
+
+/* number of points thread coordinate c owns out of n along an axis split p ways */
+static int cube_count(int n, int p, int c){
+  return n / p + (c < n % p);
+}
+
+/*
+ * Factor THREADS into the thread grid with the smallest sub-cube surface
+ * for an n^3 interior.  Returns -1 if there are more threads than points
+ * along every possible split.
+ */
+static int cube_factor(int n, int p[3]){
+
+  int pi, pj, pk;
+  double ei, ej, ek, area, best = -1.0;
+
+  for (pi = THREADS; pi >= 1; pi--) {
+    if (THREADS % pi || pi > n) continue;
+    for (pj = THREADS/pi; pj >= 1; pj--) {
+      if ((THREADS/pi) % pj || pj > n) continue;
+      pk = THREADS/pi/pj;
+      if (pk > n) continue;
+
+      ei = (double)n/pi;
+      ej = (double)n/pj;
+      ek = (double)n/pk;
+      area = ej*ek + ei*ek + ei*ej;
+
+      /* on a tie keep the split with the fewest threads along k, the unit-stride axis */
+      if (best < 0.0 || area < best) {
+	best = area;
+	p[0] = pi;
+	p[1] = pj;
+	p[2] = pk;
+      }
+    }
+  }
+
+  return (best < 0.0) ? -1 : 0;
+}
+
+/*
+ * Set up the sub-cube of MYTHREAD, either on the thread grid given as
+ * "PXxPYxPZ" or, if spec is NULL, on the one chosen by cube_factor.
+ */
+static int cube_init(cube_t *c, unsigned int size, const char *spec, sk_type type){
+
+  int a, m[3];
+
+  c->size = size;
+  c->n = size-2;
+  c->type = type;
+  c->elem = sk_type_size(type);
+
+  if (spec != NULL) {
+    if (sscanf(spec, "%dx%dx%d", &c->p[0], &c->p[1], &c->p[2]) != 3) return -1;
+    if (c->p[0] < 1 || c->p[1] < 1 || c->p[2] < 1) return -1;
+    if (c->p[0]*c->p[1]*c->p[2] != THREADS) return -1;
+  }
+  else if (cube_factor(c->n, c->p) != 0) return -1;
+
+  c->c[0] = MYTHREAD / (c->p[1]*c->p[2]);
+  c->c[1] = (MYTHREAD / c->p[2]) % c->p[1];
+  c->c[2] = MYTHREAD % c->p[2];
+
+  for (a = 0; a < 3; a++) {
+    if (c->p[a] > c->n) return -1;
+    c->len[a] = cube_count(c->n, c->p[a], c->c[a]);
+    c->lo[a] = 1 + c->c[a]*(c->n / c->p[a]) + (c->c[a] < c->n % c->p[a] ? c->c[a] : c->n % c->p[a]);
+    c->ext[a] = c->len[a] + 2;
+    m[a] = cube_count(c->n, c->p[a], 0);
+  }
+
+  /* every slot can hold the largest face of any sub-cube */
+  c->slot = m[1]*m[2];
+  if ((size_t)m[0]*m[2] > c->slot) c->slot = m[0]*m[2];
+  if ((size_t)m[0]*m[1] > c->slot) c->slot = m[0]*m[1];
+
+  return 0;
+}
+
+/*
+ * Thread at offset d from MYTHREAD in the thread grid, or -1 past the
+ * domain edge.  A periodic grid wraps around instead.
+ */
+static int cube_neighbour(const cube_t *c, const int d[3]){
+
+  int a, q[3];
+
+  for (a = 0; a < 3; a++) {
+    q[a] = c->c[a] + d[a];
+    if (c->bc == SK_PERIODIC) q[a] = (q[a] + c->p[a]) % c->p[a];
+    else if (q[a] < 0 || q[a] >= c->p[a]) return -1;
+  }
+
+  return (q[0]*c->p[1] + q[1])*c->p[2] + q[2];
+}
+
+/* send buffer slot holding the boundary region facing direction d */
+static int cube_slot(const int d[3]){
+  return (d[0]+1)*9 + (d[1]+1)*3 + (d[2]+1);
+}
+
+/*
+ * Region of the private block exchanged in direction d: the owned
+ * points next to that side if ghost is 0, or the ghost points beyond it
+ * if ghost is 1.  Along the axes where d is 0 the region spans all the
+ * owned points.
+ */
+static void cube_region(const cube_t *c, const int d[3], int ghost, int from[3], int count[3]){
+
+  int a;
+
+  for (a = 0; a < 3; a++) {
+    if (d[a] == 0) {
+      from[a] = 1;
+      count[a] = c->len[a];
+    }
+    else {
+      from[a] = (d[a] < 0) ? (ghost ? 0 : 1) : (ghost ? c->len[a]+1 : c->len[a]);
+      count[a] = 1;
+    }
+  }
+}
+
+/* copy a region of the private block to or from a packed buffer */
+static size_t cube_copy(const cube_t *c, char *block, char *packed, const int from[3], const int count[3], int unpack){
+
+  int i, j;
+  size_t row = count[2]*c->elem;
+  char *p = packed;
+  char *b;
+
+  for (i = from[0]; i < from[0] + count[0]; i++) {
+    for (j = from[1]; j < from[1] + count[1]; j++) {
+      b = block + (((size_t)i*c->ext[1] + j)*c->ext[2] + from[2])*c->elem;
+      if (unpack) memcpy(b, p, row);
+      else memcpy(p, b, row);
+      p += row;
+    }
+  }
+
+  return p - packed;
+}
+
+/* whether a 19 or 27 point stencil reads across direction d */
+static int cube_needed(int points, const int d[3]){
+  return points == 27 || abs(d[0]) + abs(d[1]) + abs(d[2]) < 3;
+}
+
+/* publish the boundary regions of the block in this thread's send buffer */
+static void cube_pack(const cube_t *c, int points, char *block, char *send){
+
+  int d[3], from[3], count[3];
+
+  for (d[0] = -1; d[0] <= 1; d[0]++) {
+    for (d[1] = -1; d[1] <= 1; d[1]++) {
+      for (d[2] = -1; d[2] <= 1; d[2]++) {
+	if (cube_slot(d) == 13 || !cube_needed(points, d) || cube_neighbour(c, d) < 0) continue;
+	cube_region(c, d, 0, from, count);
+	cube_copy(c, block, send + cube_slot(d)*c->slot*c->elem, from, count, 0);
+      }
+    }
+  }
+}
+
+/*
+ * Fetch the regions facing this thread from the send buffers of its
+ * neighbours into the ghost layer of the block.  Returns the number of
+ * bytes fetched.
+ */
+static size_t cube_fetch(const cube_t *c, int points, char *block, shared slab_ptr *dir, char *recv){
+
+  int d[3], e[3], from[3], count[3];
+  int t;
+  size_t bytes, total = 0;
+
+  for (d[0] = -1; d[0] <= 1; d[0]++) {
+    for (d[1] = -1; d[1] <= 1; d[1]++) {
+      for (d[2] = -1; d[2] <= 1; d[2]++) {
+	if (cube_slot(d) == 13 || !cube_needed(points, d)) continue;
+	if ((t = cube_neighbour(c, d)) < 0) continue;
+
+	/* the neighbour stored it in the slot facing back at us */
+	e[0] = -d[0];
+	e[1] = -d[1];
+	e[2] = -d[2];
+
+	cube_region(c, d, 1, from, count);
+	bytes = (size_t)count[0]*count[1]*count[2]*c->elem;
+	upc_memget(recv, dir[t] + cube_slot(e)*c->slot*c->elem, bytes);
+	cube_copy(c, block, recv, from, count, 1);
+	total += bytes;
+      }
+    }
+  }
+
+  return total;
+}
+
+/*
+ * Mirror the owned points next to the edges of the domain into the
+ * ghost layer beyond them, for a zero-gradient boundary.  The axes are
+ * done in turn over the whole extent of the block, so that the edge and
+ * corner ghosts get the mirror of a mirror.
+ */
+static void cube_mirror(const cube_t *c, char *block){
+
+  int a, x, y, b0, b1;
+  size_t st[3], base;
+
+  if (c->bc != SK_NEUMANN) return;
+
+  st[0] = (size_t)c->ext[1]*c->ext[2];
+  st[1] = c->ext[2];
+  st[2] = 1;
+
+  for (a = 0; a < 3; a++) {
+    b0 = (a + 1) % 3;
+    b1 = (a + 2) % 3;
+    for (x = 0; x < c->ext[b0]; x++) {
+      for (y = 0; y < c->ext[b1]; y++) {
+	base = x*st[b0] + y*st[b1];
+	if (c->c[a] == 0) {
+	  memcpy(block + base*c->elem, block + (base + st[a])*c->elem, c->elem);
+	}
+	if (c->c[a] == c->p[a]-1) {
+	  memcpy(block + (base + (c->len[a]+1)*st[a])*c->elem, block + (base + c->len[a]*st[a])*c->elem, c->elem);
+	}
+      }
+    }
+  }
+}
+
+/*
+ * Free the work and receive buffers and the send buffers with their
+ * directory, any of which may be NULL.  Collective.
+ */
+static void cube_free(shared slab_ptr *dir, char *a0, char *a1, char *recv){
+
+  free(a0);
+  free(a1);
+  free(recv);
+
+  upc_barrier;
+
+  if (dir != NULL) upc_free(dir[MYTHREAD]);
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) upc_free(dir);
+}
+
+/*
+ * 27- or 19-point stencil on a grid decomposed over a 3D thread grid.
+ *
+ * Every iteration each thread packs the boundary regions of its
+ * sub-cube into its send buffer and, after a barrier, fetches the
+ * regions its neighbours packed for it with one upc_memget per face,
+ * edge and (for the 27-point stencil) corner.  The barrier that keeps a
+ * send buffer from being repacked while it is still being read is split
+ * around the sweep.
+ */
+void stencil_cube(unsigned int size, int points, bench_opts *opts){
+
+  int i, j, k, iter, t;
+  int fail;
+  double fac = stencil_fac(points);
+  double checksum, t_setup, v, max = 0.0, scale;
+  long long sum;
+  size_t block, bytes = 0;
+  unsigned long long g;
+  char *a0, *a1, *tmp, *send, *recv;
+  char title[80];
+
+  cube_t c;
+  sk_type type;
+  sk_bc bc;
+  shared slab_ptr *dir;
+  shared unsigned long *halo;
+
+  struct timespec start, end;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (slab_bc(opts->bc, &bc) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s boundary, use fixed, periodic or neumann\n", points, opts->bc);
+    return;
+  }
+
+  if (cube_init(&c, size, opts->pgrid, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no valid thread grid for %d threads on a %d^3 interior\n", points, THREADS, size-2);
+    return;
+  }
+
+  c.bc = bc;
+
+  /* Work buffers, with ghosts, and the send buffer */
+  block = (size_t)c.ext[0]*c.ext[1]*c.ext[2];
+  a0 = calloc(block, c.elem);
+  a1 = calloc(block, c.elem);
+  recv = malloc(c.slot*c.elem);
+
+  dir = (shared slab_ptr *)upc_all_alloc(THREADS, sizeof(slab_ptr));
+  if (dir != NULL) dir[MYTHREAD] = (slab_ptr)upc_alloc(27*c.slot*c.elem);
+
+  upc_barrier;
+
+  fail = (a0 == NULL || a1 == NULL || recv == NULL || dir == NULL);
+  for (t = 0; dir != NULL && t < THREADS; t++) {
+    if (dir[t] == NULL) fail = 1;
+  }
+
+  /* a0, a1 and recv are private, so every thread must hear of a failure before any returns */
+  if (any_thread(fail)) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    cube_free(dir, a0, a1, recv);
+    return;
+  }
+
+  send = (char *)dir[MYTHREAD];
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  /* fill the owned interior, keyed on the global index of every point */
+  clock_gettime(CLOCK, &start);
+
+  for (i = 1; i < c.len[0]+1; i++) {
+    for (j = 1; j < c.len[1]+1; j++) {
+      for (k = 1; k < c.len[2]+1; k++) {
+	g = ((unsigned long long)(c.lo[0]+i-1)*size + c.lo[1]+j-1)*size + c.lo[2]+k-1;
+	sk_set(type, a0, ((size_t)i*c.ext[1] + j)*c.ext[2] + k, sk_init_value(type, g));
+      }
+    }
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+  t_setup = elapsed_seconds(start, end);
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (iter = 0; iter < opts->reps; iter++) {
+
+    cube_pack(&c, points, a0, send);
+
+    /* neighbours have packed our ghost regions */
+    upc_barrier;
+
+    bytes = cube_fetch(&c, points, a0, dir, recv);
+    cube_mirror(&c, a0);
+
+    /* neighbours may repack once everyone has fetched */
+    upc_notify;
+
+    sk_sweep(type, points, a1, a0, c.ext[1], c.ext[2], 1, c.len[0]+1, 0, 0, fac, NULL);
+
+    upc_wait;
+
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = a0;
+    a0 = a1;
+    a1 = tmp;
+
+  } /* end iteration loop */
+
+  clock_gettime(CLOCK, &end);
+
+  halo = (shared unsigned long *)upc_all_alloc(THREADS, sizeof(unsigned long));
+  halo[MYTHREAD] = bytes;
+
+  for (i = 1; i < c.len[0]+1; i++) {
+    for (j = 1; j < c.len[1]+1; j++) {
+      for (k = 1; k < c.len[2]+1; k++) {
+	v = fabs(sk_get(type, a0, ((size_t)i*c.ext[1] + j)*c.ext[2] + k));
+	if (v > max) max = v;
+      }
+    }
+  }
+
+  scale = sk_checksum_scale(max, (double)c.n*c.n*c.n);
+
+  sum = 0;
+  for (i = 1; i < c.len[0]+1; i++) {
+    for (j = 1; j < c.len[1]+1; j++) {
+      for (k = 1; k < c.len[2]+1; k++) {
+	sum += sk_term(sk_get(type, a0, ((size_t)i*c.ext[1] + j)*c.ext[2] + k), scale);
+      }
+    }
+  }
+
+  /* includes a barrier, so all of halo is set */
+  checksum = sk_checksum(sum, scale);
+
+  if (MYTHREAD == 0){
+    for (t = 0; t < THREADS; t++) {
+      if (halo[t] > bytes) bytes = halo[t];
+    }
+
+    if (bc == SK_FIXED) sprintf(title, "Stencil - %d point %s (%dx%dx%d thread grid)", points, sk_type_name(type), c.p[0], c.p[1], c.p[2]);
+    else sprintf(title, "Stencil - %d point %s, %s (%dx%dx%d thread grid)", points, sk_type_name(type), sk_bc_name(bc), c.p[0], c.p[1], c.p[2]);
+    elapsed_time_hr(start, end, title);
+    printf("Thread grid decomposition: %dx%dx%d points on thread 0, up to %lu bytes of halo per thread per iteration (%lu with slabs)\n",
+	   c.len[0], c.len[1], c.len[2], (unsigned long)bytes, (unsigned long)(2*(size_t)size*size*c.elem));
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  /* Free memory to prevent leaks */
+  cube_free(dir, a0, a1, recv);
+
+  if (MYTHREAD == 0) upc_free(halo);
+
+}
@@ -0,0 +1,362 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+ * This software was developed as part of the
+ * EC FP7 funded project Adept (Project ID: 610490)
+ * www.adept-project.eu
+ */
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * UPC Stencil benchmark - kernels specialised at run time
+ *
+ * The generic sweeps take the grid size and the weight as arguments.
+ * Here the sweep for one stencil, element type, size and weight is
+ * written out as C with all of them as constants, compiled into a shared
+ * object with the system compiler and loaded with dlopen.  The objects
+ * are cached on disk under a name that includes a hash of the source and
+ * of the compiler command, so a later run with the same parameters only
+ * pays for the load.
+ *
+ * The compiler, its flags and the cache directory are taken from
+ * SK_JIT_CC, SK_JIT_CFLAGS and SK_JIT_DIR, defaulting to the values
+ * below and to upc-kernel-jit under $XDG_CACHE_HOME or $HOME/.cache.  On
+ * a machine whose nodes do not share the cache directory every node
+ * builds its own copy.
+ *
+ * Whatever is in the cache is loaded into every thread, so the directory
+ * is created private to the user, and neither it nor an object in it is
+ * used unless it belongs to the user and no one else can write to it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include <upc.h>
+
+#include "utils.h"
+#include "stencil.h"
+
+#define SK_JIT_DIR "upc-kernel-jit"
+#define SK_JIT_CC "cc"
+#define SK_JIT_CFLAGS "-O3 -march=native"
+
+/* largest generated source file */
+#define SK_JIT_SOURCE 4096
+
+/* status of the build on thread 0 */
+static shared int sk_jit_status;
+
+static const char *sk_jit_env(const char *name, const char *fallback){
+
+  const char *v = getenv(name);
+
+  return (v != NULL && v[0] != '\0') ? v : fallback;
+}
+
+/*
+ * The cache directory: SK_JIT_DIR if set, or SK_JIT_DIR under the user's
+ * cache directory, which is created if need be.  Returns -1 if there is
+ * no such directory or its name does not fit.
+ */
+static int sk_jit_dir(char *buf, size_t len){
+
+  const char *home;
+  char cache[400];
+  int n;
+
+  if ((home = getenv("SK_JIT_DIR")) != NULL && home[0] != '\0') {
+    n = snprintf(buf, len, "%s", home);
+    return (n < 0 || (size_t)n >= len) ? -1 : 0;
+  }
+
+  if ((home = getenv("XDG_CACHE_HOME")) != NULL && home[0] != '\0') {
+    n = snprintf(cache, sizeof(cache), "%s", home);
+  }
+  else if ((home = getenv("HOME")) != NULL && home[0] != '\0') {
+    n = snprintf(cache, sizeof(cache), "%s/.cache", home);
+  }
+  else return -1;
+
+  if (n < 0 || (size_t)n >= sizeof(cache)) return -1;
+  mkdir(cache, 0700);
+
+  n = snprintf(buf, len, "%s/%s", cache, SK_JIT_DIR);
+  return (n < 0 || (size_t)n >= len) ? -1 : 0;
+}
+
+/*
+ * Whether path, not followed if it is a link, is a directory (dir) or a
+ * regular file that belongs to this user and that neither group nor
+ * others can write to
+ */
+static int sk_jit_trusted(const char *path, int dir){
+
+  struct stat st;
+
+  if (lstat(path, &st) != 0) return 0;
+  if (dir ? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode)) return 0;
+  if (st.st_uid != geteuid()) return 0;
+
+  return (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+/*
+ * Neighbour sum of each stencil, with the terms in the same order as in
+ * the generic kernels so that the results agree to the last bit
+ */
+static const char *sk_jit_sum(int points){
+
+  switch (points) {
+  case 27:
+    return "cm[k] + cp[k] + mc[k] + pc[k] + mm[k] + mp[k] + pm[k] + pp[k] +\n"
+      "\t\tcm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] + mm[k-1] + mp[k-1] + pm[k-1] + pp[k-1] +\n"
+      "\t\tcm[k+1] + cp[k+1] + mc[k+1] + pc[k+1] + mm[k+1] + mp[k+1] + pm[k+1] + pp[k+1] +\n"
+      "\t\tc[k-1] + c[k+1]";
+  case 19:
+    return "cm[k] + cp[k] + mc[k] + pc[k] + mm[k] + mp[k] + pm[k] + pp[k] +\n"
+      "\t\tcm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +\n"
+      "\t\tcm[k+1] + cp[k+1] + mc[k+1] + pc[k+1] +\n"
+      "\t\tc[k-1] + c[k+1]";
+  case 9:
+    return "c[k-1] + c[k+1] + m[k] + p[k] + m[k-1] + m[k+1] + p[k-1] + p[k+1]";
+  default:
+    return "c[k-1] + c[k+1] + m[k] + p[k]";
+  }
+}
+
+/*
+ * Write the specialised sweep of planes [plo, phi) of a block of
+ * size x size planes (3D) or rows of size (2D).  The weight is written
+ * in hexadecimal, and as a float for float grids as the generic kernels
+ * use it, so it is exact.  Returns -1 if the buffer is too small.
+ */
+static int sk_jit_source(char *buf, size_t len, sk_type type, int points, int size, double fac){
+
+  int n;
+  char w[40];
+
+  if (type == SK_FLOAT) sprintf(w, "%af", (double)(float)fac);
+  else sprintf(w, "%a", fac);
+
+  if (points >= 19) {
+    n = snprintf(buf, len,
+		 "/* %d point %s stencil on %d^3 points, weight %s */\n"
+		 "#include <stddef.h>\n"
+		 "typedef %s elem;\n"
+		 "#define COLS %d\n"
+		 "#define S2 ((size_t)COLS*COLS)\n"
+		 "void sk_jit_sweep(void *dstv, const void *srcv, int plo, int phi){\n"
+		 "  elem *restrict dst = dstv;\n"
+		 "  const elem *restrict src = srcv;\n"
+		 "  int i, j, k;\n"
+		 "  for (i = plo; i < phi; i++) {\n"
+		 "    for (j = 1; j < COLS-1; j++) {\n"
+		 "      const elem *restrict c = src + i*S2 + j*COLS;\n"
+		 "      const elem *restrict cm = c - COLS, *restrict cp = c + COLS;\n"
+		 "      const elem *restrict mc = c - S2, *restrict pc = c + S2;\n"
+		 "      const elem *restrict mm = mc - COLS, *restrict mp = mc + COLS;\n"
+		 "      const elem *restrict pm = pc - COLS, *restrict pp = pc + COLS;\n"
+		 "      elem *restrict d = dst + i*S2 + j*COLS;\n"
+		 "      for (k = 1; k < COLS-1; k++) {\n"
+		 "\td[k] = (%s) * %s;\n"
+		 "      }\n"
+		 "    }\n"
+		 "  }\n"
+		 "}\n",
+		 points, sk_type_name(type), size, w, sk_type_name(type), size, sk_jit_sum(points), w);
+  }
+  else {
+    n = snprintf(buf, len,
+		 "/* %d point %s stencil on %d^2 points, weight %s */\n"
+		 "typedef %s elem;\n"
+		 "#define COLS %d\n"
+		 "void sk_jit_sweep(void *dstv, const void *srcv, int plo, int phi){\n"
+		 "  elem *restrict dst = dstv;\n"
+		 "  const elem *restrict src = srcv;\n"
+		 "  int i, k;\n"
+		 "  for (i = plo; i < phi; i++) {\n"
+		 "    const elem *restrict c = src + i*COLS;\n"
+		 "    const elem *restrict m = c - COLS, *restrict p = c + COLS;\n"
+		 "    elem *restrict d = dst + i*COLS;\n"
+		 "    for (k = 1; k < COLS-1; k++) {\n"
+		 "      d[k] = (%s) * %s;\n"
+		 "    }\n"
+		 "  }\n"
+		 "}\n",
+		 points, sk_type_name(type), size, w, sk_type_name(type), size, sk_jit_sum(points), w);
+  }
+
+  return (n < 0 || (size_t)n >= len) ? -1 : 0;
+}
+
+/* FNV-1a hash of a string, continuing from h */
+static unsigned long long sk_jit_hash(unsigned long long h, const char *s){
+
+  while (*s) {
+    h ^= (unsigned char)*s++;
+    h *= 1099511628211ULL;
+  }
+
+  return h;
+}
+
+/*
+ * Compile the source into base.so, keeping it as base.c.  Both are
+ * written under names private to this thread and renamed into place, so
+ * that threads building the same kernel never see a partial file.
+ */
+static int sk_jit_build(const char *src, const char *base, const char *cc, const char *flags){
+
+  char csrc[512], tmp[512], path[512], opath[512], cmd[2048];
+  FILE *fp;
+  int n, status;
+
+  n = snprintf(csrc, sizeof(csrc), "%s.%d.%ld.c", base, MYTHREAD, (long)getpid());
+  if (n < 0 || (size_t)n >= sizeof(csrc)) return -1;
+  n = snprintf(tmp, sizeof(tmp), "%s.%d.%ld.so", base, MYTHREAD, (long)getpid());
+  if (n < 0 || (size_t)n >= sizeof(tmp)) return -1;
+  n = snprintf(path, sizeof(path), "%s.c", base);
+  if (n < 0 || (size_t)n >= sizeof(path)) return -1;
+  n = snprintf(opath, sizeof(opath), "%s.so", base);
+  if (n < 0 || (size_t)n >= sizeof(opath)) return -1;
+  n = snprintf(cmd, sizeof(cmd), "%s %s -fPIC -shared -o %s %s", cc, flags, tmp, csrc);
+  if (n < 0 || (size_t)n >= sizeof(cmd)) return -1;
+
+  if ((fp = fopen(csrc, "w")) == NULL) return -1;
+  fputs(src, fp);
+  if (fclose(fp) != 0) return -1;
+
+  status = system(cmd);
+
+  rename(csrc, path);
+
+  if (status != 0) {
+    remove(tmp);
+    return -1;
+  }
+
+  return (rename(tmp, opath) == 0) ? 0 : -1;
+}
+
+/*
+ * Build (unless cached) and load the specialised sweep.  Thread 0 builds
+ * a missing kernel while the others wait, and any thread that still
+ * cannot see it, on a node that does not share the cache, builds its own
+ * unless the build failed on thread 0.  Collective; returns -1 on every
+ * thread if any of them failed to build or load it.
+ */
+int sk_jit_load(sk_jit_t *jit, sk_type type, int points, int size, double fac){
+
+  const char *cc = sk_jit_env("SK_JIT_CC", SK_JIT_CC);
+  const char *flags = sk_jit_env("SK_JIT_CFLAGS", SK_JIT_CFLAGS);
+  char src[SK_JIT_SOURCE], dir[400], base[512];
+  unsigned long long key;
+  int n, t, status = 0;
+  shared int *ok;
+
+  struct timespec t0, t1, t2;
+
+  jit->handle = NULL;
+  jit->sweep = NULL;
+  jit->cached = 1;
+  jit->path[0] = '\0';
+
+  clock_gettime(CLOCK, &t0);
+
+  if (sk_jit_source(src, sizeof(src), type, points, size, fac) != 0) status = -1;
+
+  if (status == 0 && sk_jit_dir(dir, sizeof(dir)) != 0) status = -1;
+
+  if (status == 0) {
+    mkdir(dir, 0700);
+    snprintf(jit->path, sizeof(jit->path), "%s", dir);
+    if (!sk_jit_trusted(dir, 1)) status = -1;
+  }
+
+  if (status == 0) {
+    key = sk_jit_hash(sk_jit_hash(sk_jit_hash(14695981039346656037ULL, src), cc), flags);
+    n = snprintf(base, sizeof(base), "%s/sk%d_%s_%d_%016llx", dir, points, sk_type_name(type), size, key);
+    if (n < 0 || (size_t)n >= sizeof(base)) status = -1;
+    else snprintf(jit->path, sizeof(jit->path), "%s.so", base);
+  }
+
+  if (MYTHREAD == 0) {
+    if (status == 0 && access(jit->path, R_OK) != 0) {
+      jit->cached = 0;
+      status = sk_jit_build(src, base, cc, flags);
+    }
+    sk_jit_status = status;
+  }
+
+  upc_barrier;
+
+  /* a failed compile would fail on every thread, so only retry a kernel thread 0 built */
+  if (MYTHREAD != 0 && status == 0 && sk_jit_status != 0) status = -1;
+
+  if (MYTHREAD != 0 && status == 0 && access(jit->path, R_OK) != 0) {
+    jit->cached = 0;
+    status = sk_jit_build(src, base, cc, flags);
+  }
+
+  clock_gettime(CLOCK, &t1);
+
+  if (status == 0 && !sk_jit_trusted(jit->path, 0)) {
+    fprintf(stderr, "Thread %d: %s is not a private file of this user, not loading it\n", MYTHREAD, jit->path);
+    status = -1;
+  }
+
+  if (status == 0) {
+    jit->handle = dlopen(jit->path, RTLD_NOW | RTLD_LOCAL);
+    if (jit->handle != NULL) *(void **)(&jit->sweep) = dlsym(jit->handle, "sk_jit_sweep");
+    if (jit->sweep == NULL) fprintf(stderr, "Thread %d: %s\n", MYTHREAD, dlerror());
+  }
+
+  clock_gettime(CLOCK, &t2);
+
+  jit->build = elapsed_seconds(t0, t1);
+  jit->load = elapsed_seconds(t1, t2);
+
+  ok = (shared int *)upc_all_alloc(THREADS, sizeof(int));
+  ok[MYTHREAD] = (jit->sweep != NULL);
+
+  upc_barrier;
+
+  for (t = 0; t < THREADS; t++) {
+    if (!ok[t]) status = -1;
+  }
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) upc_free(ok);
+
+  if (status != 0) sk_jit_close(jit);
+
+  return status;
+}
+
+void sk_jit_close(sk_jit_t *jit){
+
+  if (jit->handle != NULL) dlclose(jit->handle);
+  jit->handle = NULL;
+  jit->sweep = NULL;
+}
@@ -0,0 +1,640 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+* This software was developed as part of the
+* EC FP7 funded project Adept (Project ID: 610490)
+* www.adept-project.eu
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+/*
+ * Stencil sweeps over one thread's block of a slab-distributed grid.
+ *
+ * This file is a template: it is included once per flavour of kernel
+ * with the following macros defined, and undefines them at the end.
+ *
+ *   SK_BASE      element type: int, float or double
+ *   SK_QUAL      qualifier of the block pointers: empty for private
+ *                pointers, shared [] for pointers-to-shared
+ *   SK_RESTRICT  restrict for private pointers, empty otherwise
+ *   SK_SIMD      loop pragma placed before the unit-stride loops
+ *   SK_FAC       type the neighbour weight is applied in
+ *   SK_GEN       generic block pointer type taken by the dispatcher
+ *   SK_NAME(x)   name of kernel x in this flavour
+ *   SK_ACC       (optional) wider type for the mixed precision kernels,
+ *                which are only generated when it is defined
+ *
+ * The point count is fixed at compile time in each kernel.  A block is
+ * made of planes of rows x cols points (a single row of cols points for
+ * the 2D kernels), halos included.  All kernels update local planes
+ * [plo, phi) of a block and sum their terms in the same order as the
+ * cyclic kernels in stencil.c, so every layout produces the same values.
+ * The 3D kernels only update rows [jlo, jhi) and columns [klo, khi) of
+ * each plane, so that a sweep can be split into tiles.
+ *
+ * The variable coefficient kernels weight each class of neighbour (the
+ * faces, edges and corners of the 3x3x3 cube) with a coefficient per
+ * point, read from arrays laid out like the grid.
+ *
+ * The mixed precision kernels read and write SK_BASE but sum the
+ * neighbours either in SK_ACC or in SK_BASE with compensated (Kahan)
+ * summation.  The compensation only survives if the compiler keeps to
+ * the source order of floating point operations, so they must not be
+ * built with options that let it reassociate them.
+ *
+ * The colour kernels are the in-place Gauss-Seidel counterparts of the
+ * compact kernels, updating one colour class of points at a time.
+ *
+ * The star kernels apply a high-order stencil of radius R: w[0] weights
+ * the centre point and w[m] the points m away along each axis.  R is a
+ * constant in every call made by the dispatcher, so once inlined the
+ * loop over it is unrolled.
+ */
+
+#define SK_ELEM SK_QUAL SK_BASE
+#define SK_COEF SK_QUAL SK_FAC
+
+/* 27-point update of a 3D block */
+static void SK_NAME(sweep27)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int rows, int cols, int plo, int phi, int jlo, int jhi, int klo, int khi, SK_FAC fac, double *res){
+
+  int i, j, k;
+  size_t s2 = (size_t)rows*cols;
+  double sum = 0.0, e;
+
+  for (i = plo; i < phi; i++) {
+    for (j = jlo; j < jhi; j++) {
+
+      const SK_ELEM *SK_RESTRICT c  = src + i*s2 + j*cols;
+      const SK_ELEM *SK_RESTRICT cm = c - cols, *SK_RESTRICT cp = c + cols;
+      const SK_ELEM *SK_RESTRICT mc = c - s2,   *SK_RESTRICT pc = c + s2;
+      const SK_ELEM *SK_RESTRICT mm = mc - cols, *SK_RESTRICT mp = mc + cols;
+      const SK_ELEM *SK_RESTRICT pm = pc - cols, *SK_RESTRICT pp = pc + cols;
+      SK_ELEM *SK_RESTRICT d = dst + i*s2 + j*cols;
+
+      SK_SIMD
+      for (k = klo; k < khi; k++) {
+	d[k] = (cm[k] + cp[k] + mc[k] + pc[k] +
+		mm[k] + mp[k] + pm[k] + pp[k] +
+
+		cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +
+		mm[k-1] + mp[k-1] + pm[k-1] + pp[k-1] +
+
+		cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1] +
+		mm[k+1] + mp[k+1] + pm[k+1] + pp[k+1] +
+
+		c[k-1] + c[k+1]) * fac;
+      }
+
+      if (res != NULL) {
+	for (k = klo; k < khi; k++) {
+	  e = (double)d[k] - c[k];
+	  sum += e*e;
+	}
+      }
+    }
+  }
+
+  if (res != NULL) *res += sum;
+}
+
+/* 19-point update of a 3D block */
+static void SK_NAME(sweep19)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int rows, int cols, int plo, int phi, int jlo, int jhi, int klo, int khi, SK_FAC fac, double *res){
+
+  int i, j, k;
+  size_t s2 = (size_t)rows*cols;
+  double sum = 0.0, e;
+
+  for (i = plo; i < phi; i++) {
+    for (j = jlo; j < jhi; j++) {
+
+      const SK_ELEM *SK_RESTRICT c  = src + i*s2 + j*cols;
+      const SK_ELEM *SK_RESTRICT cm = c - cols, *SK_RESTRICT cp = c + cols;
+      const SK_ELEM *SK_RESTRICT mc = c - s2,   *SK_RESTRICT pc = c + s2;
+      const SK_ELEM *SK_RESTRICT mm = mc - cols, *SK_RESTRICT mp = mc + cols;
+      const SK_ELEM *SK_RESTRICT pm = pc - cols, *SK_RESTRICT pp = pc + cols;
+      SK_ELEM *SK_RESTRICT d = dst + i*s2 + j*cols;
+
+      SK_SIMD
+      for (k = klo; k < khi; k++) {
+	d[k] = (cm[k] + cp[k] + mc[k] + pc[k] +
+		mm[k] + mp[k] + pm[k] + pp[k] +
+
+		cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +
+
+		cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1] +
+
+		c[k-1] + c[k+1]) * fac;
+      }
+
+      if (res != NULL) {
+	for (k = klo; k < khi; k++) {
+	  e = (double)d[k] - c[k];
+	  sum += e*e;
+	}
+      }
+    }
+  }
+
+  if (res != NULL) *res += sum;
+}
+
+/* 9-point update of a 2D block, one row per plane */
+static void SK_NAME(sweep9)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int rows, int cols, int plo, int phi, SK_FAC fac, double *res){
+
+  int i, j;
+  double sum = 0.0, e;
+
+  for (i = plo; i < phi; i++) {
+
+    const SK_ELEM *SK_RESTRICT c = src + i*cols;
+    const SK_ELEM *SK_RESTRICT m = c - cols, *SK_RESTRICT p = c + cols;
+    SK_ELEM *SK_RESTRICT d = dst + i*cols;
+
+    SK_SIMD
+    for (j = 1; j < cols-1; j++) {
+      d[j] = (c[j-1] + c[j+1] +
+	      m[j] + p[j] +
+	      m[j-1] + m[j+1] +
+	      p[j-1] + p[j+1]) * fac;
+    }
+
+    if (res != NULL) {
+      for (j = 1; j < cols-1; j++) {
+	e = (double)d[j] - c[j];
+	sum += e*e;
+      }
+    }
+  }
+
+  if (res != NULL) *res += sum;
+}
+
+/* 5-point update of a 2D block, one row per plane */
+static void SK_NAME(sweep5)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int rows, int cols, int plo, int phi, SK_FAC fac, double *res){
+
+  int i, j;
+  double sum = 0.0, e;
+
+  for (i = plo; i < phi; i++) {
+
+    const SK_ELEM *SK_RESTRICT c = src + i*cols;
+    const SK_ELEM *SK_RESTRICT m = c - cols, *SK_RESTRICT p = c + cols;
+    SK_ELEM *SK_RESTRICT d = dst + i*cols;
+
+    SK_SIMD
+    for (j = 1; j < cols-1; j++) {
+      d[j] = (c[j-1] + c[j+1]
+	      + m[j] + p[j]) * fac;
+    }
+
+    if (res != NULL) {
+      for (j = 1; j < cols-1; j++) {
+	e = (double)d[j] - c[j];
+	sum += e*e;
+      }
+    }
+  }
+
+  if (res != NULL) *res += sum;
+}
+
+/*
+ * 27-point update with a coefficient per point for each class of
+ * neighbour: wf for the 6 faces, we for the 12 edges and wc for the 8
+ * corners
+ */
+static void SK_NAME(vsweep27)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, const SK_COEF *SK_RESTRICT wf, const SK_COEF *SK_RESTRICT we, const SK_COEF *SK_RESTRICT wc, int rows, int cols, int plo, int phi, int jlo, int jhi, int klo, int khi){
+
+  int i, j, k;
+  size_t s2 = (size_t)rows*cols;
+
+  for (i = plo; i < phi; i++) {
+    for (j = jlo; j < jhi; j++) {
+
+      size_t o = i*s2 + j*cols;
+      const SK_ELEM *SK_RESTRICT c  = src + o;
+      const SK_ELEM *SK_RESTRICT cm = c - cols, *SK_RESTRICT cp = c + cols;
+      const SK_ELEM *SK_RESTRICT mc = c - s2,   *SK_RESTRICT pc = c + s2;
+      const SK_ELEM *SK_RESTRICT mm = mc - cols, *SK_RESTRICT mp = mc + cols;
+      const SK_ELEM *SK_RESTRICT pm = pc - cols, *SK_RESTRICT pp = pc + cols;
+      const SK_COEF *SK_RESTRICT f = wf + o, *SK_RESTRICT e = we + o, *SK_RESTRICT v = wc + o;
+      SK_ELEM *SK_RESTRICT d = dst + o;
+
+      SK_SIMD
+      for (k = klo; k < khi; k++) {
+	d[k] = f[k] * (cm[k] + cp[k] + mc[k] + pc[k] + c[k-1] + c[k+1]) +
+
+	       e[k] * (mm[k] + mp[k] + pm[k] + pp[k] +
+		       cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +
+		       cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1]) +
+
+	       v[k] * (mm[k-1] + mp[k-1] + pm[k-1] + pp[k-1] +
+		       mm[k+1] + mp[k+1] + pm[k+1] + pp[k+1]);
+      }
+    }
+  }
+}
+
+/* 19-point update with a coefficient per point for the faces (wf) and the edges (we) */
+static void SK_NAME(vsweep19)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, const SK_COEF *SK_RESTRICT wf, const SK_COEF *SK_RESTRICT we, int rows, int cols, int plo, int phi, int jlo, int jhi, int klo, int khi){
+
+  int i, j, k;
+  size_t s2 = (size_t)rows*cols;
+
+  for (i = plo; i < phi; i++) {
+    for (j = jlo; j < jhi; j++) {
+
+      size_t o = i*s2 + j*cols;
+      const SK_ELEM *SK_RESTRICT c  = src + o;
+      const SK_ELEM *SK_RESTRICT cm = c - cols, *SK_RESTRICT cp = c + cols;
+      const SK_ELEM *SK_RESTRICT mc = c - s2,   *SK_RESTRICT pc = c + s2;
+      const SK_ELEM *SK_RESTRICT mm = mc - cols, *SK_RESTRICT mp = mc + cols;
+      const SK_ELEM *SK_RESTRICT pm = pc - cols, *SK_RESTRICT pp = pc + cols;
+      const SK_COEF *SK_RESTRICT f = wf + o, *SK_RESTRICT e = we + o;
+      SK_ELEM *SK_RESTRICT d = dst + o;
+
+      SK_SIMD
+      for (k = klo; k < khi; k++) {
+	d[k] = f[k] * (cm[k] + cp[k] + mc[k] + pc[k] + c[k-1] + c[k+1]) +
+
+	       e[k] * (mm[k] + mp[k] + pm[k] + pp[k] +
+		       cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +
+		       cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1]);
+      }
+    }
+  }
+}
+
+/* star stencil of radius R on a 3D block */
+static inline void SK_NAME(star3)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int rows, int cols, int plo, int phi, int jlo, int jhi, int klo, int khi, const int R, const SK_FAC *w){
+
+  int i, j, k, m;
+  size_t s2 = (size_t)rows*cols;
+  SK_FAC acc;
+
+  for (i = plo; i < phi; i++) {
+    for (j = jlo; j < jhi; j++) {
+
+      const SK_ELEM *SK_RESTRICT c = src + i*s2 + j*cols;
+      SK_ELEM *SK_RESTRICT d = dst + i*s2 + j*cols;
+
+      SK_SIMD
+      for (k = klo; k < khi; k++) {
+	acc = w[0] * c[k];
+	for (m = 1; m <= R; m++) {
+	  acc += w[m] * (c[k-m] + c[k+m] +
+			 c[k-m*cols] + c[k+m*cols] +
+			 c[k-m*s2] + c[k+m*s2]);
+	}
+	d[k] = acc;
+      }
+    }
+  }
+}
+
+/* star stencil of radius R on a 2D block, one row per plane */
+static inline void SK_NAME(star2)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int cols, int plo, int phi, const int R, const SK_FAC *w){
+
+  int i, j, m;
+  SK_FAC acc;
+
+  for (i = plo; i < phi; i++) {
+
+    const SK_ELEM *SK_RESTRICT c = src + i*cols;
+    SK_ELEM *SK_RESTRICT d = dst + i*cols;
+
+    SK_SIMD
+    for (j = R; j < cols-R; j++) {
+      acc = w[0] * c[j];
+      for (m = 1; m <= R; m++) {
+	acc += w[m] * (c[j-m] + c[j+m] +
+		       c[j-m*cols] + c[j+m*cols]);
+      }
+      d[j] = acc;
+    }
+  }
+}
+
+/*
+ * Update planes [plo, phi) with the star stencil of radius r (1 to
+ * SK_MAX_RADIUS) and weights w, in tiles of tj x tk points in 3D.  The
+ * block has a fixed halo r points wide.
+ */
+static void SK_NAME(sweep_star)(int dims, int r, const double *w, SK_GEN *dst, SK_GEN *src, int rows, int cols, int plo, int phi, int tj, int tk){
+
+  int m, jj, kk, jhi, khi;
+  SK_FAC wf[SK_MAX_RADIUS+1];
+  SK_ELEM *d = (SK_ELEM *)dst;
+  const SK_ELEM *c = (const SK_ELEM *)src;
+
+  for (m = 0; m <= r; m++) wf[m] = (SK_FAC)w[m];
+
+  if (dims == 2) {
+    switch (r) {
+    case 1: SK_NAME(star2)(d, c, cols, plo, phi, 1, wf); break;
+    case 2: SK_NAME(star2)(d, c, cols, plo, phi, 2, wf); break;
+    case 3: SK_NAME(star2)(d, c, cols, plo, phi, 3, wf); break;
+    case 4: SK_NAME(star2)(d, c, cols, plo, phi, 4, wf); break;
+    }
+    return;
+  }
+
+  if (tj <= 0) tj = rows-2*r;
+  if (tk <= 0) tk = cols-2*r;
+
+  for (jj = r; jj < rows-r; jj += tj) {
+    jhi = (jj + tj < rows-r) ? jj + tj : rows-r;
+    for (kk = r; kk < cols-r; kk += tk) {
+      khi = (kk + tk < cols-r) ? kk + tk : cols-r;
+      switch (r) {
+      case 1: SK_NAME(star3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 1, wf); break;
+      case 2: SK_NAME(star3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 2, wf); break;
+      case 3: SK_NAME(star3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 3, wf); break;
+      case 4: SK_NAME(star3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 4, wf); break;
+      }
+    }
+  }
+}
+
+/*
+ * Gauss-Seidel update, in place, of the points of one colour of a 3D
+ * block.  The colour of a point is given by the parities of its global
+ * plane index g, row j and column k (bits 0, 1 and 2), so none of the
+ * 26 neighbours of a point has its colour and each colour can be
+ * updated in any order.  Local plane i is global plane i + goff.
+ */
+static void SK_NAME(colour3)(SK_ELEM *a, int rows, int cols, int plo, int phi, int goff, int colour, int points, SK_FAC fac){
+
+  int i, j, k;
+  size_t s2 = (size_t)rows*cols;
+
+  for (i = plo; i < phi; i++) {
+
+    if (((i + goff) & 1) != (colour & 1)) continue;
+
+    for (j = 2 - ((colour >> 1) & 1); j < rows-1; j += 2) {
+
+      SK_ELEM *c  = a + i*s2 + j*cols;
+      const SK_ELEM *cm = c - cols, *cp = c + cols;
+      const SK_ELEM *mc = c - s2,   *pc = c + s2;
+      const SK_ELEM *mm = mc - cols, *mp = mc + cols;
+      const SK_ELEM *pm = pc - cols, *pp = pc + cols;
+
+      if (points == 27) {
+	for (k = 2 - ((colour >> 2) & 1); k < cols-1; k += 2) {
+	  c[k] = (cm[k] + cp[k] + mc[k] + pc[k] +
+		  mm[k] + mp[k] + pm[k] + pp[k] +
+
+		  cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +
+		  mm[k-1] + mp[k-1] + pm[k-1] + pp[k-1] +
+
+		  cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1] +
+		  mm[k+1] + mp[k+1] + pm[k+1] + pp[k+1] +
+
+		  c[k-1] + c[k+1]) * fac;
+	}
+      }
+      else {
+	for (k = 2 - ((colour >> 2) & 1); k < cols-1; k += 2) {
+	  c[k] = (cm[k] + cp[k] + mc[k] + pc[k] +
+		  mm[k] + mp[k] + pm[k] + pp[k] +
+
+		  cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1] +
+
+		  cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1] +
+
+		  c[k-1] + c[k+1]) * fac;
+	}
+      }
+    }
+  }
+}
+
+/*
+ * The same for a 2D block.  The 5 point stencil is coloured red-black by
+ * the parity of g + j; the 9 point one uses four colours, the parities of
+ * g (bit 0) and j (bit 1).
+ */
+static void SK_NAME(colour2)(SK_ELEM *a, int cols, int plo, int phi, int goff, int colour, int points, SK_FAC fac){
+
+  int i, j;
+
+  for (i = plo; i < phi; i++) {
+
+    SK_ELEM *c = a + i*cols;
+    const SK_ELEM *m = c - cols, *p = c + cols;
+
+    if (points == 5) {
+      for (j = 2 - ((colour ^ (i + goff)) & 1); j < cols-1; j += 2) {
+	c[j] = (c[j-1] + c[j+1]
+		+ m[j] + p[j]) * fac;
+      }
+    }
+    else if (((i + goff) & 1) == (colour & 1)) {
+      for (j = 2 - ((colour >> 1) & 1); j < cols-1; j += 2) {
+	c[j] = (c[j-1] + c[j+1] +
+		m[j] + p[j] +
+		m[j-1] + m[j+1] +
+		p[j-1] + p[j+1]) * fac;
+      }
+    }
+  }
+}
+
+/* update the points of one colour of planes [plo, phi) in place */
+static void SK_NAME(colour)(int points, SK_GEN *grid, int rows, int cols, int plo, int phi, int goff, int colour, double fac){
+
+  SK_ELEM *a = (SK_ELEM *)grid;
+
+  if (points >= 19) SK_NAME(colour3)(a, rows, cols, plo, phi, goff, colour, points, (SK_FAC)fac);
+  else SK_NAME(colour2)(a, cols, plo, phi, goff, colour, points, (SK_FAC)fac);
+}
+
+/*
+ * Update planes [plo, phi) with the kernel for the given point count.
+ * The 3D kernels run over tiles of tj rows by tk columns, each carried
+ * through all the planes before moving to the next, so only three tiles
+ * of input planes need to stay in cache; 0 means a whole plane.
+ *
+ * If res is not NULL, the sum of the squared changes (the squared Jacobi
+ * residual) is added to it in the same pass, a row at a time while the
+ * row is still in cache.
+ */
+static void SK_NAME(sweep)(int points, SK_GEN *dst, SK_GEN *src, int rows, int cols, int plo, int phi, int tj, int tk, double fac, double *res){
+
+  int jj, kk, jhi, khi;
+  SK_ELEM *d = (SK_ELEM *)dst;
+  const SK_ELEM *c = (const SK_ELEM *)src;
+
+  if (tj <= 0) tj = rows-2;
+  if (tk <= 0) tk = cols-2;
+
+  switch (points) {
+  case 27:
+  case 19:
+    for (jj = 1; jj < rows-1; jj += tj) {
+      jhi = (jj + tj < rows-1) ? jj + tj : rows-1;
+      for (kk = 1; kk < cols-1; kk += tk) {
+	khi = (kk + tk < cols-1) ? kk + tk : cols-1;
+	if (points == 27) SK_NAME(sweep27)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, (SK_FAC)fac, res);
+	else SK_NAME(sweep19)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, (SK_FAC)fac, res);
+      }
+    }
+    break;
+  case 9:  SK_NAME(sweep9)(d, c, rows, cols, plo, phi, (SK_FAC)fac, res); break;
+  case 5:  SK_NAME(sweep5)(d, c, rows, cols, plo, phi, (SK_FAC)fac, res); break;
+  }
+}
+
+/*
+ * Update planes [plo, phi) with the variable coefficient 27 or 19 point
+ * kernel, with coef[0], coef[1] and coef[2] the face, edge and corner
+ * coefficient blocks, tiled as in the constant coefficient sweep
+ */
+static void SK_NAME(vsweep)(int points, SK_GEN *dst, SK_GEN *src, SK_GEN *coef[3], int rows, int cols, int plo, int phi, int tj, int tk){
+
+  int jj, kk, jhi, khi;
+  SK_ELEM *d = (SK_ELEM *)dst;
+  const SK_ELEM *c = (const SK_ELEM *)src;
+  const SK_COEF *wf = (const SK_COEF *)coef[0];
+  const SK_COEF *we = (const SK_COEF *)coef[1];
+  const SK_COEF *wc = (const SK_COEF *)coef[2];
+
+  if (tj <= 0) tj = rows-2;
+  if (tk <= 0) tk = cols-2;
+
+  for (jj = 1; jj < rows-1; jj += tj) {
+    jhi = (jj + tj < rows-1) ? jj + tj : rows-1;
+    for (kk = 1; kk < cols-1; kk += tk) {
+      khi = (kk + tk < cols-1) ? kk + tk : cols-1;
+      if (points == 27) SK_NAME(vsweep27)(d, c, wf, we, wc, rows, cols, plo, phi, jj, jhi, kk, khi);
+      else SK_NAME(vsweep19)(d, c, wf, we, rows, cols, plo, phi, jj, jhi, kk, khi);
+    }
+  }
+}
+
+#ifdef SK_ACC
+
+/* add x to sum, carrying the rounding error in comp */
+#define SK_KAHAN(x) do { y = (x) - comp; t = sum + y; comp = (t - sum) - y; sum = t; } while (0)
+
+/*
+ * 27-point (corners set) or 19-point update of a 3D block whose sums are
+ * carried in SK_ACC, or in SK_BASE with compensation if kahan is set.
+ * The terms are added in the same order as by sweep27 and sweep19.  The
+ * compensated sum is scaled in SK_ACC: rounding the factor itself to
+ * SK_BASE would bias every update the same way, which after a few
+ * hundred sweeps costs more than the summation does.
+ */
+static inline void SK_NAME(mixed3)(SK_ELEM *SK_RESTRICT dst, const SK_ELEM *SK_RESTRICT src, int rows, int cols, int plo, int phi, int jlo, int jhi, int klo, int khi, const int corners, const int kahan, SK_ACC fac){
+
+  int i, j, k;
+  size_t s2 = (size_t)rows*cols;
+  SK_ACC acc;
+  SK_BASE sum, comp, y, t;
+
+  for (i = plo; i < phi; i++) {
+    for (j = jlo; j < jhi; j++) {
+
+      const SK_ELEM *SK_RESTRICT c  = src + i*s2 + j*cols;
+      const SK_ELEM *SK_RESTRICT cm = c - cols, *SK_RESTRICT cp = c + cols;
+      const SK_ELEM *SK_RESTRICT mc = c - s2,   *SK_RESTRICT pc = c + s2;
+      const SK_ELEM *SK_RESTRICT mm = mc - cols, *SK_RESTRICT mp = mc + cols;
+      const SK_ELEM *SK_RESTRICT pm = pc - cols, *SK_RESTRICT pp = pc + cols;
+      SK_ELEM *SK_RESTRICT d = dst + i*s2 + j*cols;
+
+      if (kahan) {
+	SK_SIMD
+	for (k = klo; k < khi; k++) {
+	  sum = cm[k];
+	  comp = 0;
+	  SK_KAHAN(cp[k]); SK_KAHAN(mc[k]); SK_KAHAN(pc[k]);
+	  SK_KAHAN(mm[k]); SK_KAHAN(mp[k]); SK_KAHAN(pm[k]); SK_KAHAN(pp[k]);
+
+	  SK_KAHAN(cm[k-1]); SK_KAHAN(cp[k-1]); SK_KAHAN(mc[k-1]); SK_KAHAN(pc[k-1]);
+	  if (corners) { SK_KAHAN(mm[k-1]); SK_KAHAN(mp[k-1]); SK_KAHAN(pm[k-1]); SK_KAHAN(pp[k-1]); }
+
+	  SK_KAHAN(cm[k+1]); SK_KAHAN(cp[k+1]); SK_KAHAN(mc[k+1]); SK_KAHAN(pc[k+1]);
+	  if (corners) { SK_KAHAN(mm[k+1]); SK_KAHAN(mp[k+1]); SK_KAHAN(pm[k+1]); SK_KAHAN(pp[k+1]); }
+
+	  SK_KAHAN(c[k-1]); SK_KAHAN(c[k+1]);
+
+	  d[k] = (SK_BASE)(((SK_ACC)sum - comp) * fac);
+	}
+      }
+      else {
+	SK_SIMD
+	for (k = klo; k < khi; k++) {
+	  acc = (SK_ACC)cm[k] + cp[k] + mc[k] + pc[k] +
+		mm[k] + mp[k] + pm[k] + pp[k];
+
+	  acc = acc + cm[k-1] + cp[k-1] + mc[k-1] + pc[k-1];
+	  if (corners) acc = acc + mm[k-1] + mp[k-1] + pm[k-1] + pp[k-1];
+
+	  acc = acc + cm[k+1] + cp[k+1] + mc[k+1] + pc[k+1];
+	  if (corners) acc = acc + mm[k+1] + mp[k+1] + pm[k+1] + pp[k+1];
+
+	  acc = acc + c[k-1] + c[k+1];
+
+	  d[k] = (SK_BASE)(acc * fac);
+	}
+      }
+    }
+  }
+}
+
+#undef SK_KAHAN
+
+/*
+ * Update planes [plo, phi) with the mixed precision 27 or 19 point
+ * kernel, summing in SK_ACC or, if kahan is set, with compensation,
+ * tiled as in the plain sweep
+ */
+static void SK_NAME(mixed)(int points, int kahan, SK_GEN *dst, SK_GEN *src, int rows, int cols, int plo, int phi, int tj, int tk, double fac){
+
+  int jj, kk, jhi, khi;
+  SK_ELEM *d = (SK_ELEM *)dst;
+  const SK_ELEM *c = (const SK_ELEM *)src;
+
+  if (tj <= 0) tj = rows-2;
+  if (tk <= 0) tk = cols-2;
+
+  for (jj = 1; jj < rows-1; jj += tj) {
+    jhi = (jj + tj < rows-1) ? jj + tj : rows-1;
+    for (kk = 1; kk < cols-1; kk += tk) {
+      khi = (kk + tk < cols-1) ? kk + tk : cols-1;
+      if (points == 27) {
+	if (kahan) SK_NAME(mixed3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 1, 1, (SK_ACC)fac);
+	else SK_NAME(mixed3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 1, 0, (SK_ACC)fac);
+      }
+      else {
+	if (kahan) SK_NAME(mixed3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 0, 1, (SK_ACC)fac);
+	else SK_NAME(mixed3)(d, c, rows, cols, plo, phi, jj, jhi, kk, khi, 0, 0, (SK_ACC)fac);
+      }
+    }
+  }
+}
+
+#undef SK_ACC
+#endif
+
+#undef SK_ELEM
+#undef SK_COEF
+#undef SK_BASE
+#undef SK_QUAL
+#undef SK_RESTRICT
+#undef SK_SIMD
+#undef SK_FAC
+#undef SK_GEN
+#undef SK_NAME
@@ -0,0 +1,635 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+ * This software was developed as part of the
+ * EC FP7 funded project Adept (Project ID: 610490)
+ * www.adept-project.eu
+ */
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * UPC Multigrid benchmark - geometric V-cycle on slab levels
+ *
+ * Solves A u = f on the 27-point (3D) or 5-point (2D) grid with fixed
+ * zero boundaries, where A = I - fac * (sum of the neighbours) is the
+ * operator whose Jacobi iteration the stencil benchmark runs.  Every
+ * level is a vertex-centred grid of 2n+1 -> n interior points per axis,
+ * split into blocks of planes as in slab mode.  Levels are smoothed with
+ * the private slab sweep, restricted by full weighting and prolonged by
+ * (bi/tri)linear interpolation.
+ *
+ * A level with fewer than MG_MIN_PLANES planes per thread is folded onto
+ * fewer threads; the rest wait at the barriers.  The time, the transfers
+ * and the barrier wait of every level are reported, since the coarse
+ * levels are latency bound and leave most threads idle.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <upc.h>
+
+#include "level1.h"
+#include "utils.h"
+#include "stencil.h"
+
+/* most levels of a hierarchy */
+#define MG_MAX_LEVELS 16
+
+/* fewest planes per thread before a level is folded onto fewer threads */
+#define MG_MIN_PLANES 4
+
+/* fewest interior points per axis of the coarsest level */
+#define MG_MIN_POINTS 3
+
+/* smoothing sweeps before and after the coarse grid correction, and on the coarsest level */
+#define MG_PRE 2
+#define MG_POST 2
+#define MG_COARSE 20
+
+/* One level of the hierarchy */
+typedef struct {
+  int n;          /* interior points per dimension */
+  int size;       /* points per dimension, including the boundary (n+2) */
+  int dims;       /* 2 or 3 */
+  size_t plane;   /* doubles per i-plane */
+  int nth;        /* threads holding planes of this level */
+  int i0;         /* global index of the first plane owned by MYTHREAD */
+  int nloc;       /* planes owned by MYTHREAD, 0 if it is idle on this level */
+  slab_buf_t u;   /* solution, with a ghost plane on either side */
+  slab_buf_t t;   /* sweep output, then the residual */
+  double *f;      /* right-hand side, laid out like u */
+  double *stage;  /* planes fetched from the level above or below */
+  double work, comm, wait;  /* seconds MYTHREAD spent computing, fetching and in barriers */
+  double bytes;   /* bytes MYTHREAD fetched from other threads */
+} mg_level_t;
+
+/* number of planes owned by thread t */
+static int mg_count(const mg_level_t *l, int t){
+  return (t < l->nth) ? l->n / l->nth + (t < l->n % l->nth) : 0;
+}
+
+/* global index of the first plane of thread t */
+static int mg_first(const mg_level_t *l, int t){
+
+  int base = l->n / l->nth, rem = l->n % l->nth;
+
+  if (t > l->nth) t = l->nth;
+  return 1 + t*base + (t < rem ? t : rem);
+}
+
+/* thread owning interior plane i */
+static int mg_owner(const mg_level_t *l, int i){
+
+  int base = l->n / l->nth, rem = l->n % l->nth;
+  int cut = rem * (base+1);
+
+  i -= 1;
+  return (i < cut) ? i / (base+1) : rem + (i - cut) / base;
+}
+
+/* add the seconds since *last to *acc and restart the clock */
+static void mg_tick(struct timespec *last, double *acc){
+
+  struct timespec now;
+
+  clock_gettime(CLOCK, &now);
+  *acc += elapsed_seconds(*last, now);
+  *last = now;
+}
+
+/*
+ * Copy global plane i (0 to n+1) of a level's grid into dst.  The
+ * boundary planes are zero.  Returns the bytes fetched from another thread.
+ */
+static size_t mg_get(const mg_level_t *l, const slab_buf_t *b, int i, double *dst){
+
+  int t;
+  size_t bytes = l->plane * sizeof(double);
+  slab_ptr src;
+
+  if (i < 1 || i > l->n) {
+    memset(dst, 0, bytes);
+    return 0;
+  }
+
+  t = mg_owner(l, i);
+  if (t == MYTHREAD) {
+    memcpy(dst, (double *)b->mine + (i - l->i0 + 1)*l->plane, bytes);
+    return 0;
+  }
+
+  src = b->dir[t];
+  upc_memget(dst, src + (i - mg_first(l, t) + 1)*bytes, bytes);
+
+  return bytes;
+}
+
+/* refresh the two ghost planes of this thread's block of u */
+static void mg_exchange(mg_level_t *l){
+
+  double *u = l->u.mine;
+
+  if (l->nloc == 0) return;
+
+  l->bytes += mg_get(l, &l->u, l->i0 - 1, u);
+  l->bytes += mg_get(l, &l->u, l->i0 + l->nloc, u + (l->nloc+1)*l->plane);
+}
+
+/*
+ * Allocate a zeroed block per thread and exchange the block addresses.
+ * Collective; returns -1 on every thread, with nothing left allocated,
+ * if any allocation failed.
+ */
+static int mg_alloc(const mg_level_t *l, slab_buf_t *b){
+
+  int t, fail = 0;
+  size_t bytes = (l->nloc + 2) * l->plane * sizeof(double);
+
+  b->dir = (shared slab_ptr *)upc_all_alloc(THREADS, sizeof(slab_ptr));
+  if (b->dir == NULL) return -1;
+
+  b->dir[MYTHREAD] = (slab_ptr)upc_alloc(bytes);
+
+  upc_barrier;
+
+  for (t = 0; t < THREADS; t++) {
+    if (b->dir[t] == NULL) fail = 1;
+  }
+
+  /* give back the blocks that were allocated, and the directory once all have read it */
+  if (fail) {
+    if (b->dir[MYTHREAD] != NULL) upc_free(b->dir[MYTHREAD]);
+    upc_barrier;
+    if (MYTHREAD == 0) upc_free(b->dir);
+    return -1;
+  }
+
+  b->own = b->dir[MYTHREAD];
+  b->mine = (void *)b->own;
+  b->lo = NULL;
+  b->hi = NULL;
+  memset(b->mine, 0, bytes);
+
+  return 0;
+}
+
+/*
+ * Set up level l of n interior points per axis on nth threads, with a
+ * staging area large enough for planes of the level above (fine_plane
+ * doubles each) and below (coarse_plane).  Collective.
+ */
+static int mg_level(mg_level_t *l, int n, int dims, int nth, size_t fine_plane, size_t coarse_plane){
+
+  size_t stage;
+
+  l->n = n;
+  l->size = n + 2;
+  l->dims = dims;
+  l->plane = (dims == 3) ? (size_t)l->size*l->size : (size_t)l->size;
+  l->nth = nth;
+  l->nloc = mg_count(l, MYTHREAD);
+  l->i0 = mg_first(l, MYTHREAD);
+  l->work = l->comm = l->wait = l->bytes = 0.0;
+
+  /* restriction needs 2 nloc + 1 fine planes, prolongation nloc/2 + 2 coarse ones */
+  stage = (2*l->nloc + 1) * fine_plane;
+  if ((l->nloc/2 + 2) * coarse_plane > stage) stage = (l->nloc/2 + 2) * coarse_plane;
+
+  l->f = calloc((l->nloc + 2) * l->plane, sizeof(double));
+  l->stage = malloc((stage + 1) * sizeof(double));
+
+  /* f and stage are private, so every thread must hear of a failure before any returns */
+  if (any_thread(l->f == NULL || l->stage == NULL) || mg_alloc(l, &l->u) != 0) {
+    free(l->f);
+    free(l->stage);
+    return -1;
+  }
+
+  if (mg_alloc(l, &l->t) != 0) {
+    slab_free(&l->u);
+    free(l->f);
+    free(l->stage);
+    return -1;
+  }
+
+  return 0;
+}
+
+static void mg_free(mg_level_t *l){
+
+  slab_free(&l->u);
+  slab_free(&l->t);
+  free(l->f);
+  free(l->stage);
+}
+
+/*
+ * t = a*u + b*(t + f - u) over the owned interior points, where t holds
+ * fac times the neighbour sum of u.  With a = 1, b = omega this is a
+ * damped Jacobi step, with a = 0, b = 1 the residual.  Returns the sum of
+ * the squared residuals.
+ */
+static double mg_combine(const mg_level_t *l, double a, double b){
+
+  int p, j;
+  int r0 = (l->dims == 3) ? 1 : 0, r1 = (l->dims == 3) ? l->n + 1 : 1;
+  size_t k, x;
+  double *t = l->t.mine;
+  const double *u = l->u.mine, *f = l->f;
+  double r, sum = 0.0;
+
+  for (p = 1; p <= l->nloc; p++) {
+    for (j = r0; j < r1; j++) {
+      x = p*l->plane + j*l->size;
+      for (k = x + 1; k < x + l->n + 1; k++) {
+	r = t[k] + f[k] - u[k];
+	t[k] = a*u[k] + b*r;
+	sum += r*r;
+      }
+    }
+  }
+
+  return sum;
+}
+
+/* weight of the neighbours, so that the diagonal of A is one */
+static double mg_fac(int points){
+  return 1.0 / (points - 1);
+}
+
+/* Jacobi damping that smooths the oscillatory modes of each operator */
+static double mg_omega(int points){
+  return (points == 27) ? 1.0 : 0.8;
+}
+
+/* sweeps damped Jacobi steps of level l.  Collective. */
+static void mg_smooth(mg_level_t *l, int points, int sweeps){
+
+  int s;
+  slab_buf_t tmp;
+  struct timespec c;
+
+  for (s = 0; s < sweeps; s++) {
+
+    clock_gettime(CLOCK, &c);
+    mg_exchange(l);
+    mg_tick(&c, &l->comm);
+
+    if (l->nloc) {
+      sk_sweep(SK_DOUBLE, points, l->t.mine, l->u.mine, l->size, l->size, 1, 1 + l->nloc, 0, 0, mg_fac(points), NULL);
+      mg_combine(l, 1.0, mg_omega(points));
+    }
+    mg_tick(&c, &l->work);
+
+    /* neighbours must have fetched our boundary planes before they change */
+    upc_barrier;
+    mg_tick(&c, &l->wait);
+
+    tmp = l->u;
+    l->u = l->t;
+    l->t = tmp;
+  }
+}
+
+/* residual of level l into t; returns the local sum of its squares.  Collective. */
+static double mg_residual(mg_level_t *l, int points){
+
+  double sum = 0.0;
+  struct timespec c;
+
+  clock_gettime(CLOCK, &c);
+  mg_exchange(l);
+  mg_tick(&c, &l->comm);
+
+  if (l->nloc) {
+    sk_sweep(SK_DOUBLE, points, l->t.mine, l->u.mine, l->size, l->size, 1, 1 + l->nloc, 0, 0, mg_fac(points), NULL);
+    sum = mg_combine(l, 0.0, 1.0);
+  }
+  mg_tick(&c, &l->work);
+
+  upc_barrier;
+  mg_tick(&c, &l->wait);
+
+  return sum;
+}
+
+/* full weighting of a fine row about point 2K */
+static double mg_fw(const double *row, int k){
+  return 0.25*row[k-1] + 0.5*row[k] + 0.25*row[k+1];
+}
+
+/* full weighting of a fine plane about point (2J, 2K) */
+static double mg_fw_plane(const mg_level_t *f, const double *pl, int j, int k){
+
+  if (f->dims == 2) return mg_fw(pl, k);
+
+  return 0.25*mg_fw(pl + (j-1)*f->size, k) + 0.5*mg_fw(pl + j*f->size, k) + 0.25*mg_fw(pl + (j+1)*f->size, k);
+}
+
+/*
+ * Restrict the residual of fine level f onto the right-hand side of the
+ * next level c, and zero the solution there.  Each thread of c fetches
+ * the fine planes it needs from their owners.  The factor of 4 is the
+ * ratio of the grid spacings squared, by which A shrinks on the coarser
+ * grid.  Collective; the time is charged to the fine level.
+ */
+static void mg_restrict(mg_level_t *f, mg_level_t *c){
+
+  int p, j, k, q;
+  int first = 2*c->i0 - 1;
+  int r0 = (c->dims == 3) ? 1 : 0, r1 = (c->dims == 3) ? c->n + 1 : 1;
+  struct timespec t;
+
+  clock_gettime(CLOCK, &t);
+  for (q = 0; q < 2*c->nloc + 1 && c->nloc; q++) {
+    f->bytes += mg_get(f, &f->t, first + q, c->stage + q*f->plane);
+  }
+  mg_tick(&t, &f->comm);
+
+  for (p = 1; p <= c->nloc; p++) {
+
+    /* fine planes 2I-1, 2I and 2I+1 of coarse plane I = i0 + p - 1 */
+    const double *lo = c->stage + (2*p - 2)*f->plane;
+    const double *mid = lo + f->plane, *hi = mid + f->plane;
+
+    for (j = r0; j < r1; j++) {
+      double *d = c->f + p*c->plane + j*c->size;
+      for (k = 1; k <= c->n; k++) {
+	d[k] = 4.0 * (0.25*mg_fw_plane(f, lo, 2*j, 2*k) + 0.5*mg_fw_plane(f, mid, 2*j, 2*k) + 0.25*mg_fw_plane(f, hi, 2*j, 2*k));
+      }
+    }
+  }
+
+  memset(c->u.mine, 0, (c->nloc + 2) * c->plane * sizeof(double));
+  mg_tick(&t, &f->work);
+
+  upc_barrier;
+  mg_tick(&t, &f->wait);
+}
+
+/* linear interpolation of a coarse row at fine point k */
+static double mg_line(const double *row, int k){
+  return (k & 1) ? 0.5*(row[k>>1] + row[(k>>1) + 1]) : row[k>>1];
+}
+
+/* linear interpolation of a coarse plane at fine point (j, k) */
+static double mg_interp(const mg_level_t *c, const double *pl, int j, int k){
+
+  if (c->dims == 2) return mg_line(pl, k);
+
+  if (j & 1) return 0.5*(mg_line(pl + (j>>1)*c->size, k) + mg_line(pl + ((j>>1) + 1)*c->size, k));
+  return mg_line(pl + (j>>1)*c->size, k);
+}
+
+/*
+ * Add the interpolated solution of coarse level c to that of fine level
+ * f.  Each thread of f fetches the coarse planes it needs from their
+ * owners.  Collective; the time is charged to the fine level.
+ */
+static void mg_prolong(mg_level_t *c, mg_level_t *f){
+
+  int p, j, k, q, i;
+  int first = f->i0 / 2, last = (f->i0 + f->nloc) / 2;
+  int r0 = (f->dims == 3) ? 1 : 0, r1 = (f->dims == 3) ? f->n + 1 : 1;
+  struct timespec t;
+
+  clock_gettime(CLOCK, &t);
+  for (q = 0; q <= last - first && f->nloc; q++) {
+    f->bytes += mg_get(c, &c->u, first + q, f->stage + q*c->plane);
+  }
+  mg_tick(&t, &f->comm);
+
+  for (p = 1; p <= f->nloc; p++) {
+
+    const double *lo, *hi;
+
+    /* an even fine plane lies on coarse plane i/2, an odd one between two */
+    i = f->i0 + p - 1;
+    lo = f->stage + (i/2 - first)*c->plane;
+    hi = (i & 1) ? lo + c->plane : lo;
+
+    for (j = r0; j < r1; j++) {
+      double *u = (double *)f->u.mine + p*f->plane + j*f->size;
+      for (k = 1; k <= f->n; k++) {
+	u[k] += 0.5*(mg_interp(c, lo, j, k) + mg_interp(c, hi, j, k));
+      }
+    }
+  }
+  mg_tick(&t, &f->work);
+
+  /* the fine solution is complete before the post-smoothing fetches it */
+  upc_barrier;
+  mg_tick(&t, &f->wait);
+}
+
+/* one V-cycle from level l down to the coarsest of nlev.  Collective. */
+static void mg_vcycle(mg_level_t *lev, int l, int nlev, int points){
+
+  if (l == nlev-1) {
+    mg_smooth(&lev[l], points, MG_COARSE);
+    return;
+  }
+
+  mg_smooth(&lev[l], points, MG_PRE);
+  mg_residual(&lev[l], points);
+  mg_restrict(&lev[l], &lev[l+1]);
+
+  mg_vcycle(lev, l+1, nlev, points);
+
+  mg_prolong(&lev[l+1], &lev[l]);
+  mg_smooth(&lev[l], points, MG_POST);
+}
+
+/* sum and largest of a per-thread value, valid on thread 0 and zero elsewhere. Collective. */
+static void mg_reduce(double value, double *sum, double *max){
+
+  int t;
+  shared double *all = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  *sum = 0.0;
+  *max = 0.0;
+  all[MYTHREAD] = value;
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) {
+    for (t = 0; t < THREADS; t++) {
+      *sum += all[t];
+      if (all[t] > *max) *max = all[t];
+    }
+    upc_free(all);
+  }
+}
+
+/* 2-norm of the residual of the finest level, valid on thread 0. Collective. */
+static double mg_norm(mg_level_t *l, int points){
+
+  double sum, max;
+
+  mg_reduce(mg_residual(l, points), &sum, &max);
+
+  return sqrt(sum);
+}
+
+/* checksum of the solution on the finest level, valid on thread 0 */
+static double mg_checksum(const mg_level_t *l){
+
+  int p, j, k, pass;
+  int r0 = (l->dims == 3) ? 1 : 0, r1 = (l->dims == 3) ? l->n + 1 : 1;
+  const double *u = l->u.mine;
+  long long sum = 0;
+  double max = 0.0, scale = 1.0;
+
+  for (pass = 0; pass < 2; pass++) {
+    for (p = 1; p <= l->nloc; p++) {
+      for (j = r0; j < r1; j++) {
+	for (k = 1; k <= l->n; k++) {
+	  double v = u[p*l->plane + j*l->size + k];
+	  if (pass) sum += sk_term(v, scale);
+	  else if (fabs(v) > max) max = fabs(v);
+	}
+      }
+    }
+    if (pass == 0) scale = sk_checksum_scale(max, pow(l->n, l->dims));
+  }
+
+  return sk_checksum(sum, scale);
+}
+
+/*
+ * V(MG_PRE, MG_POST) cycles for the 27 point (3D) or 5 point (2D)
+ * operator on a grid of size points per dimension, boundary included.
+ * size - 2 must be odd for there to be a coarser level, so 2^k + 1
+ * coarsens furthest.
+ */
+void stencil_multigrid(unsigned int size, int points, bench_opts *opts){
+
+  int l, nlev, n, nth, cycle, p, j, k;
+  int dims = (points == 27) ? 3 : 2;
+  double fac = mg_fac(points), h, r0, r1, checksum;
+  double work[3], wait_max, bytes, dummy;
+  size_t fine_plane;
+  mg_level_t lev[MG_MAX_LEVELS];
+  char title[80];
+  struct timespec start, end;
+
+  n = (int)size - 2;
+
+  if (n < THREADS) {
+    if (MYTHREAD == 0) printf("%d-point Multigrid Error: the finest level needs at least one plane per thread\n", points);
+    return;
+  }
+
+  /* coarsen while the interior stays odd and large enough */
+  nlev = 1;
+  while (nlev < MG_MAX_LEVELS && n % 2 == 1 && (n-1)/2 >= MG_MIN_POINTS) {
+    n = (n-1)/2;
+    nlev++;
+  }
+
+  if (nlev < 2) {
+    if (MYTHREAD == 0) printf("%d-point Multigrid Error: size - 2 must be odd and at least %d, e.g. a size of 2^k + 1\n", points, 2*MG_MIN_POINTS + 1);
+    return;
+  }
+
+  /* finest level on every thread, coarser ones folded onto fewer */
+  n = (int)size - 2;
+  nth = THREADS;
+  fine_plane = 0;
+  for (l = 0; l < nlev; l++) {
+    size_t plane = (dims == 3) ? (size_t)(n+2)*(n+2) : (size_t)(n+2);
+    size_t coarse = (dims == 3) ? (size_t)((n-1)/2 + 2)*((n-1)/2 + 2) : (size_t)((n-1)/2 + 2);
+
+    if (l > 0 && n / MG_MIN_PLANES < nth) nth = (n / MG_MIN_PLANES > 0) ? n / MG_MIN_PLANES : 1;
+
+    if (mg_level(&lev[l], n, dims, nth, fine_plane, coarse) != 0) {
+      /* Something went wrong in the memory allocation here, fail gracefully */
+      if (MYTHREAD == 0) printf("%d-point Multigrid Error: Unable to allocate memory\n", points);
+      while (l-- > 0) mg_free(&lev[l]);
+      return;
+    }
+
+    fine_plane = plane;
+    n = (n-1)/2;
+  }
+
+  /* A u = f for a unit source, scaled like A by the grid spacing squared */
+  h = 1.0 / (lev[0].n + 1);
+  for (p = 1; p <= lev[0].nloc; p++) {
+    for (j = (dims == 3) ? 1 : 0; j < ((dims == 3) ? lev[0].n + 1 : 1); j++) {
+      for (k = 1; k <= lev[0].n; k++) lev[0].f[p*lev[0].plane + j*lev[0].size + k] = fac * h*h;
+    }
+  }
+
+  r0 = mg_norm(&lev[0], points);
+
+  for (l = 0; l < nlev; l++) lev[l].work = lev[l].comm = lev[l].wait = lev[l].bytes = 0.0;
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  upc_barrier;
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (cycle = 0; cycle < opts->reps; cycle++) mg_vcycle(lev, 0, nlev, points);
+
+  clock_gettime(CLOCK, &end);
+
+  for (l = 0; l < nlev; l++) {
+    double w = lev[l].work, m = lev[l].comm, t = lev[l].wait, b = lev[l].bytes;
+
+    /* mg_reduce is collective, so every thread goes through every level */
+    mg_reduce(w, &work[0], &dummy);
+    mg_reduce(m, &work[1], &dummy);
+    mg_reduce(t, &work[2], &wait_max);
+    mg_reduce(b, &bytes, &dummy);
+
+    if (MYTHREAD == 0) {
+      if (l == 0) {
+	printf("\n--- Multigrid - %d point, %d levels, V(%d,%d) cycles, %d on the coarsest level\n", points, nlev, MG_PRE, MG_POST, MG_COARSE);
+	printf("--- Per level and cycle, mean over threads -------------------------------------------\n");
+	printf("|\n");
+      }
+      printf("| Level %2d  %5d^%d points  %4d thread(s)  Compute: %.3e s  Transfer: %.3e s  Wait: %.3e s (max %.3e s)  Remote: %.3lf MB\n",
+	     l, lev[l].n, dims, lev[l].nth, work[0]/THREADS/opts->reps, work[1]/THREADS/opts->reps, work[2]/THREADS/opts->reps,
+	     wait_max/opts->reps, bytes/opts->reps/1.0e6);
+    }
+  }
+
+  r1 = mg_norm(&lev[0], points);
+  checksum = mg_checksum(&lev[0]);
+
+  if (MYTHREAD == 0){
+    printf("|\n");
+    printf("------------------------------------------------------------------------------------\n");
+    sprintf(title, "Multigrid - %d point", points);
+    elapsed_time_hr(start, end, title);
+    printf("Cycles: %d, %.9lf s per cycle\n", opts->reps, elapsed_seconds(start, end) / opts->reps);
+    printf("Residual: %.6e -> %.6e, mean reduction per cycle %.4lf\n", r0, r1, (r0 > 0.0) ? pow(r1 / r0, 1.0 / opts->reps) : 0.0);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  /* Free memory to prevent leaks */
+  for (l = 0; l < nlev; l++) mg_free(&lev[l]);
+
+}
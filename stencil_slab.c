@@ -0,0 +1,2308 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/*
+ * This software was developed as part of the
+ * EC FP7 funded project Adept (Project ID: 610490)
+ * www.adept-project.eu
+ */
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+/*
+ * UPC Stencil benchmark - slab decomposition
+ *
+ * The grid is split into contiguous blocks of i-planes, one block per
+ * thread, held in that thread's local memory together with a ghost plane
+ * on either side.  Ghost planes are refreshed once per iteration with
+ * bulk upc_memget and the sweep runs on private pointers, so the remote
+ * traffic of an iteration is two planes per thread rather than most of
+ * the neighbour reads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <time.h>
+#include <sched.h>
+
+#include <upc.h>
+
+#include "level1.h"
+#include "utils.h"
+#include "stencil.h"
+
+/* largest number of tile configurations compared in one run */
+#define MAX_TILES 16
+
+static void slab_bench(slab_t *, int, bench_opts *);
+static void temporal_bench(slab_t *, int, bench_opts *);
+static void stream_bench(slab_t *, int, bench_opts *);
+static void converge_bench(slab_t *, int, bench_opts *);
+static void coef_bench(slab_t *, int, bench_opts *);
+
+/* let the compiler vectorise the unit-stride loops of the private sweeps */
+#if defined(__GNUC__)
+#define SK_IVDEP _Pragma("GCC ivdep")
+#else
+#define SK_IVDEP
+#endif
+
+/* parse a --bc name; returns -1 if there is no such boundary condition */
+int slab_bc(const char *name, sk_bc *bc){
+
+  if (strcmp(name, "fixed") == 0) *bc = SK_FIXED;
+  else if (strcmp(name, "periodic") == 0) *bc = SK_PERIODIC;
+  else if (strcmp(name, "neumann") == 0) *bc = SK_NEUMANN;
+  else return -1;
+
+  return 0;
+}
+
+/* type of the per-point coefficients: float for float grids and double otherwise */
+static sk_type slab_coef_type(const slab_t *s){
+  return (s->type == SK_FLOAT) ? SK_FLOAT : SK_DOUBLE;
+}
+
+const char *sk_bc_name(sk_bc bc){
+
+  switch (bc) {
+  case SK_PERIODIC: return "periodic";
+  case SK_NEUMANN: return "neumann";
+  default: return "fixed";
+  }
+}
+
+/* parse a --dtype name; returns -1 if it has no slab stencil */
+int slab_type(const char *name, sk_type *type){
+
+  if (strcmp(name, "int") == 0) *type = SK_INT;
+  else if (strcmp(name, "float") == 0) *type = SK_FLOAT;
+  else if (strcmp(name, "double") == 0) *type = SK_DOUBLE;
+  else return -1;
+
+  return 0;
+}
+
+const char *sk_type_name(sk_type type){
+
+  switch (type) {
+  case SK_INT: return "int";
+  case SK_FLOAT: return "float";
+  default: return "double";
+  }
+}
+
+size_t sk_type_size(sk_type type){
+
+  switch (type) {
+  case SK_INT: return sizeof(int);
+  case SK_FLOAT: return sizeof(float);
+  default: return sizeof(double);
+  }
+}
+
+/* element i of a private block, whatever its type */
+double sk_get(sk_type type, const void *a, size_t i){
+
+  switch (type) {
+  case SK_INT: return ((const int *)a)[i];
+  case SK_FLOAT: return ((const float *)a)[i];
+  default: return ((const double *)a)[i];
+  }
+}
+
+void sk_set(sk_type type, void *a, size_t i, double v){
+
+  switch (type) {
+  case SK_INT: ((int *)a)[i] = (int)v; break;
+  case SK_FLOAT: ((float *)a)[i] = (float)v; break;
+  default: ((double *)a)[i] = v; break;
+  }
+}
+
+/*
+ * Initial value of the grid point with global index idx, whatever thread
+ * owns it: a counter-based random number in [0, 1), or in [0, 1000) for
+ * integer grids.
+ */
+double sk_init_value(sk_type type, unsigned long long idx){
+
+  double u = counter_uniform(idx);
+
+  return (type == SK_INT) ? floor(u * 1000) : u;
+}
+
+/*
+ * Grid checksums round every value to fixed point and add them as
+ * integers, so a checksum does not depend on the order in which the
+ * points are visited, and is the same for any number of threads and any
+ * decomposition.  The scale is the largest power of two for which a sum
+ * of npoints values no larger than the largest on any thread still fits
+ * in 63 bits.  Collective.
+ */
+double sk_checksum_scale(double local_max, double npoints){
+
+  int t, e;
+  double max = 0.0;
+  shared double *part = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  part[MYTHREAD] = local_max;
+
+  upc_barrier;
+
+  for (t = 0; t < THREADS; t++) {
+    if (part[t] > max) max = part[t];
+  }
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) upc_free(part);
+
+  if (max == 0.0) return 1.0;
+
+  frexp(max * npoints, &e);
+
+  return ldexp(1.0, 62 - e);
+}
+
+/* checksum term of one grid value */
+long long sk_term(double v, double scale){
+  return llround(v * scale);
+}
+
+/* add up the checksum terms of all threads, valid on thread 0. Collective. */
+double sk_checksum(long long local, double scale){
+
+  int t;
+  unsigned long long total = 0;
+  shared long long *part = (shared long long *)upc_all_alloc(THREADS, sizeof(long long));
+
+  part[MYTHREAD] = local;
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) {
+    /* unsigned, so that any partial overflow wraps harmlessly */
+    for (t = 0; t < THREADS; t++) total += (unsigned long long)part[t];
+    upc_free(part);
+  }
+
+  return (long long)total / scale;
+}
+
+/*
+ * Split the n interior planes of a size^dims grid, surrounded by a fixed
+ * halo `halo` points wide, into THREADS blocks whose lengths differ by at
+ * most one.
+ *
+ * Returns -1 if a block would be shorter than the ghost region it has
+ * to supply to its neighbours.
+ */
+int slab_init(slab_t *s, unsigned int size, int dims, int halo, int ghost, sk_type type){
+
+  int base, rem;
+
+  s->size = size;
+  s->halo = halo;
+  s->n = size - 2*halo;
+  s->dims = dims;
+  s->plane = (dims == 3) ? (size_t)size*size : (size_t)size;
+  s->ghost = ghost;
+  s->type = type;
+  s->elem = sk_type_size(type);
+  s->tj = 0;
+  s->tk = 0;
+  s->star = 0;
+  s->reps = REPS;
+  s->bc = SK_FIXED;
+  s->ncoef = 0;
+  s->coef = NULL;
+  s->sum = SK_SUM_PLAIN;
+  s->jit = NULL;
+  s->p2p = 0;
+
+  base = s->n / THREADS;
+  rem = s->n % THREADS;
+
+  s->nloc = slab_count(s, MYTHREAD);
+  s->i0 = halo + MYTHREAD*base + (MYTHREAD < rem ? MYTHREAD : rem);
+
+  if (base < 1 || base < ghost) return -1;
+
+  return 0;
+}
+
+/* number of planes owned by thread t */
+int slab_count(const slab_t *s, int t){
+  return s->n / THREADS + (t < s->n % THREADS);
+}
+
+/*
+ * Allocate one block per thread and exchange the block addresses.
+ * Collective; returns -1 on every thread, with nothing left allocated,
+ * if any allocation failed.
+ */
+int slab_alloc(const slab_t *s, slab_buf_t *b){
+
+  int t, fail = 0;
+  size_t bytes = (s->nloc + 2*s->ghost) * s->plane * s->elem;
+
+  b->dir = (shared slab_ptr *)upc_all_alloc(THREADS, sizeof(slab_ptr));
+  if (b->dir == NULL) return -1;
+
+  b->dir[MYTHREAD] = (slab_ptr)upc_alloc(bytes);
+
+  upc_barrier;
+
+  for (t = 0; t < THREADS; t++) {
+    if (b->dir[t] == NULL) fail = 1;
+  }
+
+  /* give back the blocks that were allocated, and the directory once all have read it */
+  if (fail) {
+    if (b->dir[MYTHREAD] != NULL) upc_free(b->dir[MYTHREAD]);
+    upc_barrier;
+    if (MYTHREAD == 0) upc_free(b->dir);
+    return -1;
+  }
+
+  b->own = b->dir[MYTHREAD];
+  b->mine = (void *)b->own;
+  b->lo = (MYTHREAD > 0) ? b->dir[MYTHREAD-1] : NULL;
+  b->hi = (MYTHREAD < THREADS-1) ? b->dir[MYTHREAD+1] : NULL;
+
+  /* a periodic grid wraps around from the last thread to the first */
+  if (s->bc == SK_PERIODIC) {
+    b->lo = b->dir[(MYTHREAD + THREADS - 1) % THREADS];
+    b->hi = b->dir[(MYTHREAD + 1) % THREADS];
+  }
+
+  return 0;
+}
+
+void slab_free(slab_buf_t *b){
+
+  upc_barrier;
+  upc_free(b->own);
+  upc_barrier;
+
+  if (MYTHREAD == 0) upc_free(b->dir);
+}
+
+/*
+ * Allocate the two buffers of a sweep.  Collective; returns -1 on every
+ * thread, with neither left allocated, if either allocation failed.
+ */
+static int slab_alloc_pair(const slab_t *s, slab_buf_t *a0, slab_buf_t *a1){
+
+  if (slab_alloc(s, a0) != 0) return -1;
+
+  if (slab_alloc(s, a1) != 0) {
+    slab_free(a0);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Fill the in-plane halo of local planes [plo, phi) of a block for a
+ * periodic or zero-gradient boundary.  The halo columns of the interior
+ * rows are done first and then, in 3D, whole halo rows, so that the
+ * corners are filled as well.  Nothing is done for a fixed halo.
+ */
+static void slab_halo_planes(const slab_t *s, void *mine, int plo, int phi){
+
+  int p, j, m;
+  int h = s->halo, n = s->n;
+  int rlo = (s->dims == 3) ? h : 0, rhi = (s->dims == 3) ? h + n : 1;
+  size_t e = s->elem, row = s->size * s->elem;
+  char *pl, *r;
+
+  if (s->bc == SK_FIXED) return;
+
+  for (p = plo; p < phi; p++) {
+
+    pl = (char *)mine + p * s->plane * e;
+
+    for (j = rlo; j < rhi; j++) {
+      r = pl + j*row;
+      for (m = 0; m < h; m++) {
+	if (s->bc == SK_PERIODIC) {
+	  memcpy(r + (h-1-m)*e, r + (h+n-1-m)*e, e);
+	  memcpy(r + (h+n+m)*e, r + (h+m)*e, e);
+	}
+	else {
+	  memcpy(r + (h-1-m)*e, r + (h+m)*e, e);
+	  memcpy(r + (h+n+m)*e, r + (h+n-1-m)*e, e);
+	}
+      }
+    }
+
+    if (s->dims == 2) continue;
+
+    for (m = 0; m < h; m++) {
+      if (s->bc == SK_PERIODIC) {
+	memcpy(pl + (h-1-m)*row, pl + (h+n-1-m)*row, row);
+	memcpy(pl + (h+n+m)*row, pl + (h+m)*row, row);
+      }
+      else {
+	memcpy(pl + (h-1-m)*row, pl + (h+m)*row, row);
+	memcpy(pl + (h+n+m)*row, pl + (h+n-1-m)*row, row);
+      }
+    }
+  }
+}
+
+/*
+ * Mirror the first and last interior planes of the grid into the halo
+ * planes beyond them, for a zero-gradient boundary.  Only the first and
+ * last thread have any to do.
+ */
+static void slab_halo_ends(const slab_t *s, void *mine){
+
+  int m;
+  size_t bytes = s->plane * s->elem;
+  char *b = mine;
+
+  if (s->bc != SK_NEUMANN) return;
+
+  for (m = 0; m < s->halo; m++) {
+    if (MYTHREAD == 0) memcpy(b + (s->ghost-1-m)*bytes, b + (s->ghost+m)*bytes, bytes);
+    if (MYTHREAD == THREADS-1) memcpy(b + (s->ghost+s->nloc+m)*bytes, b + (s->ghost+s->nloc-1-m)*bytes, bytes);
+  }
+}
+
+/*
+ * Refresh the ghost planes of this thread's block from the boundary
+ * planes of its neighbours, and the halo of the block for the boundary
+ * condition.  With a fixed boundary the ghost planes beyond the first
+ * and last interior plane hold the halo and are never fetched.  With a
+ * periodic one the first and last thread are neighbours.  With a
+ * zero-gradient one the end threads mirror their own planes instead.
+ */
+void slab_exchange(const slab_t *s, slab_buf_t *b){
+
+  size_t bytes = s->ghost * s->plane * s->elem;
+
+  if (b->lo != NULL) {
+    upc_memget(b->mine, b->lo + slab_count(s, (MYTHREAD + THREADS - 1) % THREADS)*s->plane*s->elem, bytes);
+  }
+  if (b->hi != NULL) {
+    upc_memget((char *)b->mine + (s->ghost + s->nloc)*s->plane*s->elem, b->hi + s->ghost*s->plane*s->elem, bytes);
+  }
+
+  slab_halo_planes(s, b->mine, 0, s->nloc + 2*s->ghost);
+  slab_halo_ends(s, b->mine);
+}
+
+/*
+ * Split-phase form of slab_exchange: start the ghost plane transfers,
+ * and later wait for them to land.  Without the UPC 1.3 non-blocking
+ * library the transfers are done by slab_exchange_end and nothing can
+ * overlap them.  The halo of the owned planes is filled at the start,
+ * so that the inner planes can be swept in the meantime.
+ */
+void slab_exchange_start(const slab_t *s, slab_buf_t *b){
+
+  slab_halo_planes(s, b->mine, s->ghost, s->ghost + s->nloc);
+  slab_halo_ends(s, b->mine);
+
+#ifdef __UPC_NB__
+  size_t bytes = s->ghost * s->plane * s->elem;
+
+  b->get[0] = UPC_COMPLETE_HANDLE;
+  b->get[1] = UPC_COMPLETE_HANDLE;
+
+  if (b->lo != NULL) {
+    b->get[0] = upc_memget_nb(b->mine, b->lo + slab_count(s, (MYTHREAD + THREADS - 1) % THREADS)*s->plane*s->elem, bytes);
+  }
+  if (b->hi != NULL) {
+    b->get[1] = upc_memget_nb((char *)b->mine + (s->ghost + s->nloc)*s->plane*s->elem, b->hi + s->ghost*s->plane*s->elem, bytes);
+  }
+#endif
+}
+
+void slab_exchange_end(const slab_t *s, slab_buf_t *b){
+
+#ifdef __UPC_NB__
+  upc_sync(b->get[0]);
+  upc_sync(b->get[1]);
+
+  if (b->lo != NULL) slab_halo_planes(s, b->mine, 0, s->ghost);
+  if (b->hi != NULL) slab_halo_planes(s, b->mine, s->ghost + s->nloc, s->nloc + 2*s->ghost);
+#else
+  slab_exchange(s, b);
+#endif
+}
+
+/* checksum of the interior points of a slab-distributed grid, valid on thread 0 */
+double slab_checksum(const slab_t *s, const void *mine){
+
+  int p, j, k;
+  int r0 = (s->dims == 3) ? s->halo : 0;
+  int r1 = (s->dims == 3) ? s->halo + s->n : 1;
+  long long sum = 0;
+  double v, max = 0.0, scale;
+
+  for (p = 0; p < s->nloc; p++) {
+    size_t a = (s->ghost + p)*s->plane;
+    for (j = r0; j < r1; j++) {
+      for (k = s->halo; k < s->halo + s->n; k++) {
+	v = fabs(sk_get(s->type, mine, a + j*s->size+k));
+	if (v > max) max = v;
+      }
+    }
+  }
+
+  scale = sk_checksum_scale(max, pow(s->n, s->dims));
+
+  for (p = 0; p < s->nloc; p++) {
+    size_t a = (s->ghost + p)*s->plane;
+    for (j = r0; j < r1; j++) {
+      for (k = s->halo; k < s->halo + s->n; k++) {
+	sum += sk_term(sk_get(s->type, mine, a + j*s->size+k), scale);
+      }
+    }
+  }
+
+  return sk_checksum(sum, scale);
+}
+
+/* sweeps through restrict-qualified private pointers, one set per type */
+#define SK_BASE int
+#define SK_QUAL
+#define SK_RESTRICT restrict
+#define SK_SIMD SK_IVDEP
+#define SK_FAC double
+#define SK_GEN void
+#define SK_NAME(x) x##_private_int
+#include "stencil_kernels.h"
+
+#define SK_BASE float
+#define SK_QUAL
+#define SK_RESTRICT restrict
+#define SK_SIMD SK_IVDEP
+#define SK_FAC float
+#define SK_GEN void
+#define SK_NAME(x) x##_private_float
+#define SK_ACC double
+#include "stencil_kernels.h"
+
+#define SK_BASE double
+#define SK_QUAL
+#define SK_RESTRICT restrict
+#define SK_SIMD SK_IVDEP
+#define SK_FAC double
+#define SK_GEN void
+#define SK_NAME(x) x##_private_double
+#include "stencil_kernels.h"
+
+/* the same sweeps through pointers-to-shared with local affinity */
+#define SK_BASE int
+#define SK_QUAL shared []
+#define SK_RESTRICT
+#define SK_SIMD
+#define SK_FAC double
+#define SK_GEN shared [] char
+#define SK_NAME(x) x##_shared_int
+#include "stencil_kernels.h"
+
+#define SK_BASE float
+#define SK_QUAL shared []
+#define SK_RESTRICT
+#define SK_SIMD
+#define SK_FAC float
+#define SK_GEN shared [] char
+#define SK_NAME(x) x##_shared_float
+#include "stencil_kernels.h"
+
+#define SK_BASE double
+#define SK_QUAL shared []
+#define SK_RESTRICT
+#define SK_SIMD
+#define SK_FAC double
+#define SK_GEN shared [] char
+#define SK_NAME(x) x##_shared_double
+#include "stencil_kernels.h"
+
+/*
+ * Update planes [plo, phi) of a private block of rows x cols planes, in
+ * tiles of tj x tk points for the 3D stencils (0 for a whole plane).
+ * Unless res is NULL, the squared change of every point is added to it.
+ */
+void sk_sweep(sk_type type, int points, void *dst, void *src, int rows, int cols, int plo, int phi, int tj, int tk, double fac, double *res){
+
+  switch (type) {
+  case SK_INT: sweep_private_int(points, dst, src, rows, cols, plo, phi, tj, tk, fac, res); break;
+  case SK_FLOAT: sweep_private_float(points, dst, src, rows, cols, plo, phi, tj, tk, fac, res); break;
+  default: sweep_private_double(points, dst, src, rows, cols, plo, phi, tj, tk, fac, res); break;
+  }
+}
+
+/* update planes [plo, phi) of the private view of a slab block */
+static void slab_sweep_private(const slab_t *s, int points, void *dst, void *src, int plo, int phi, double fac){
+
+  if (s->jit != NULL) {
+    s->jit(dst, src, plo, phi);
+    return;
+  }
+
+  if (s->star) {
+    switch (s->type) {
+    case SK_INT: sweep_star_private_int(s->dims, s->star, s->w, dst, src, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    case SK_FLOAT: sweep_star_private_float(s->dims, s->star, s->w, dst, src, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    default: sweep_star_private_double(s->dims, s->star, s->w, dst, src, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    }
+    return;
+  }
+
+  if (s->sum != SK_SUM_PLAIN && s->type == SK_FLOAT) {
+    mixed_private_float(points, s->sum == SK_SUM_KAHAN, dst, src, s->size, s->size, plo, phi, s->tj, s->tk, fac);
+    return;
+  }
+
+  if (s->ncoef) {
+    void *coef[3] = { NULL, NULL, NULL };
+    int c;
+    for (c = 0; c < s->ncoef; c++) coef[c] = s->coef[c].mine;
+    switch (s->type) {
+    case SK_INT: vsweep_private_int(points, dst, src, coef, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    case SK_FLOAT: vsweep_private_float(points, dst, src, coef, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    default: vsweep_private_double(points, dst, src, coef, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    }
+    return;
+  }
+
+  sk_sweep(s->type, points, dst, src, s->size, s->size, plo, phi, s->tj, s->tk, fac, NULL);
+}
+
+/* the same through pointers-to-shared */
+static void slab_sweep_shared(const slab_t *s, int points, slab_ptr dst, slab_ptr src, int plo, int phi, double fac){
+
+  if (s->star) {
+    switch (s->type) {
+    case SK_INT: sweep_star_shared_int(s->dims, s->star, s->w, dst, src, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    case SK_FLOAT: sweep_star_shared_float(s->dims, s->star, s->w, dst, src, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    default: sweep_star_shared_double(s->dims, s->star, s->w, dst, src, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    }
+    return;
+  }
+
+  if (s->ncoef) {
+    slab_ptr coef[3] = { NULL, NULL, NULL };
+    int c;
+    for (c = 0; c < s->ncoef; c++) coef[c] = s->coef[c].own;
+    switch (s->type) {
+    case SK_INT: vsweep_shared_int(points, dst, src, coef, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    case SK_FLOAT: vsweep_shared_float(points, dst, src, coef, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    default: vsweep_shared_double(points, dst, src, coef, s->size, s->size, plo, phi, s->tj, s->tk); break;
+    }
+    return;
+  }
+
+  switch (s->type) {
+  case SK_INT: sweep_shared_int(points, dst, src, s->size, s->size, plo, phi, s->tj, s->tk, fac, NULL); break;
+  case SK_FLOAT: sweep_shared_float(points, dst, src, s->size, s->size, plo, phi, s->tj, s->tk, fac, NULL); break;
+  default: sweep_shared_double(points, dst, src, s->size, s->size, plo, phi, s->tj, s->tk, fac, NULL); break;
+  }
+}
+
+/* Gauss-Seidel update, in place, of one colour of the owned planes of a slab block */
+static void slab_colour(const slab_t *s, int points, slab_buf_t *a, int via_shared, int colour, double fac){
+
+  int plo = s->ghost, phi = s->ghost + s->nloc;
+  int goff = s->i0 - s->ghost;
+
+  if (via_shared) {
+    switch (s->type) {
+    case SK_INT: colour_shared_int(points, a->own, s->size, s->size, plo, phi, goff, colour, fac); break;
+    case SK_FLOAT: colour_shared_float(points, a->own, s->size, s->size, plo, phi, goff, colour, fac); break;
+    default: colour_shared_double(points, a->own, s->size, s->size, plo, phi, goff, colour, fac); break;
+    }
+  }
+  else {
+    switch (s->type) {
+    case SK_INT: colour_private_int(points, a->mine, s->size, s->size, plo, phi, goff, colour, fac); break;
+    case SK_FLOAT: colour_private_float(points, a->mine, s->size, s->size, plo, phi, goff, colour, fac); break;
+    default: colour_private_double(points, a->mine, s->size, s->size, plo, phi, goff, colour, fac); break;
+    }
+  }
+}
+
+/* Jacobi weight of the neighbours, as used by the cyclic kernels */
+double stencil_fac(int points){
+
+  switch (points) {
+  case 27: return 1.0/26;
+  case 19: return 1.0/18;
+  default: return 1.0/8;
+  }
+}
+
+/*
+ * Coefficients of the central difference second derivative of order 2r,
+ * from the centre point outwards
+ */
+static const double star_coef[SK_MAX_RADIUS][SK_MAX_RADIUS+1] = {
+  { -2.0, 1.0 },
+  { -5.0/2, 4.0/3, -1.0/12 },
+  { -49.0/18, 3.0/2, -3.0/20, 1.0/90 },
+  { -205.0/72, 8.0/5, -1.0/5, 8.0/315, -1.0/560 }
+};
+
+/*
+ * Weights of one explicit diffusion step with the order 2r Laplacian,
+ * u + lambda * L(u).  lambda is chosen so that the step is a contraction
+ * for any radius and dimension.
+ */
+static void star_weights(slab_t *s, int r){
+
+  int m;
+  double sum = fabs(star_coef[r-1][0]);
+  double lambda;
+
+  for (m = 1; m <= r; m++) sum += 2*fabs(star_coef[r-1][m]);
+
+  lambda = 0.5 / (s->dims * sum);
+
+  s->star = r;
+  s->w[0] = 1.0 + lambda * s->dims * star_coef[r-1][0];
+  for (m = 1; m <= r; m++) s->w[m] = lambda * star_coef[r-1][m];
+}
+
+/* name of the stencil and element type, for report titles */
+static const char *slab_label(const slab_t *s, int points){
+
+  static char label[64];
+
+  if (s->star) sprintf(label, "%d point star %s", 2*s->dims*s->star + 1, sk_type_name(s->type));
+  else sprintf(label, "%d point %s", points, sk_type_name(s->type));
+
+  if (s->bc != SK_FIXED) sprintf(label + strlen(label), ", %s", sk_bc_name(s->bc));
+  if (s->ncoef) strcat(label, ", variable");
+  if (s->sum == SK_SUM_WIDE) strcat(label, ", double sums");
+  if (s->sum == SK_SUM_KAHAN) strcat(label, ", compensated sums");
+
+  return label;
+}
+
+/* apply the run options common to the slab modes; returns -1 after reporting a bad one */
+static int slab_options(slab_t *s, int points, bench_opts *opts){
+
+  s->reps = opts->reps;
+  s->p2p = (strcmp(opts->sync, "p2p") == 0);
+
+  if (strcmp(opts->sync, "barrier") != 0 && strcmp(opts->sync, "p2p") != 0 && strcmp(opts->sync, "both") != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s synchronisation, use barrier, p2p or both\n", points, opts->sync);
+    return -1;
+  }
+
+  if (slab_bc(opts->bc, &s->bc) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s boundary, use fixed, periodic or neumann\n", points, opts->bc);
+    return -1;
+  }
+
+  if (s->bc == SK_PERIODIC && s->n < s->halo) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: a periodic grid needs at least %d interior points per dimension\n", points, s->halo);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Zero both blocks (including halos and ghosts) and fill the owned
+ * interior of a0, keyed on the global index of every point.  Collective;
+ * returns the time taken up to the closing barrier.
+ */
+static double slab_fill(const slab_t *s, slab_buf_t *a0, slab_buf_t *a1){
+
+  int i, j, k;
+  int r0 = (s->dims == 3) ? s->halo : 0;
+  int r1 = (s->dims == 3) ? s->halo + s->n : 1;
+  size_t block = (s->nloc + 2*s->ghost) * s->plane;
+  size_t g;
+
+  struct timespec start, end;
+
+  clock_gettime(CLOCK, &start);
+
+  memset(a0->mine, 0, block*s->elem);
+  if (a1 != NULL) memset(a1->mine, 0, block*s->elem);
+
+  for (i = s->ghost; i < s->ghost + s->nloc; i++) {
+    /* global index of the start of this plane */
+    g = (s->i0 + i - s->ghost) * s->plane;
+    for (j = r0; j < r1; j++) {
+      for (k = s->halo; k < s->halo + s->n; k++) {
+	sk_set(s->type, a0->mine, i*s->plane+j*s->size+k, sk_init_value(s->type, g+j*s->size+k));
+      }
+    }
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  return elapsed_seconds(start, end);
+}
+
+/*
+ * Bandwidth of a run of s->reps sweeps taking the given time, counting
+ * only the compulsory traffic of one read and one write of every
+ * interior point per sweep, and one read of each of its coefficients
+ */
+static double slab_bandwidth(const slab_t *s, double seconds){
+  return (2.0 * s->elem + s->ncoef * sk_type_size(slab_coef_type(s))) * pow(s->n, s->dims) * s->reps / seconds / 1.0e9;
+}
+
+/*
+ * Parse a list of tile sizes "TJxTK[,TJxTK...]" into at most max
+ * configurations, where 0 stands for a whole plane.  NULL gives the
+ * untiled sweep alone.  Returns the number of configurations, or -1 if
+ * the list is malformed.
+ */
+static int slab_tiles(const char *spec, int *tj, int *tk, int max){
+
+  int count = 0, len;
+
+  if (spec == NULL) {
+    tj[0] = tk[0] = 0;
+    return 1;
+  }
+
+  while (count < max && sscanf(spec, "%dx%d%n", &tj[count], &tk[count], &len) == 2) {
+    if (tj[count] < 0 || tk[count] < 0) return -1;
+    count++;
+    spec += len;
+    if (*spec == '\0') return count;
+    if (*spec++ != ',') return -1;
+  }
+
+  return -1;
+}
+
+/* largest of a per-thread value, valid on thread 0. Collective. */
+static double thread_max(double value){
+
+  int t;
+  double max = 0.0;
+  shared double *all = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  all[MYTHREAD] = value;
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) {
+    for (t = 0; t < THREADS; t++) if (all[t] > max) max = all[t];
+    upc_free(all);
+  }
+
+  return max;
+}
+
+/* mean of a per-thread value, valid on thread 0. Collective. */
+static double thread_mean(double value){
+
+  int t;
+  double sum = 0.0;
+  shared double *all = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  all[MYTHREAD] = value;
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) {
+    for (t = 0; t < THREADS; t++) sum += all[t];
+    upc_free(all);
+  }
+
+  return sum / THREADS;
+}
+
+/*
+ * Progress counters of the point-to-point synchronisation, one of each
+ * per thread: the sweeps it has completed, and the ghost plane exchanges.
+ */
+typedef struct {
+  strict shared int *done;
+  strict shared int *got;
+  int lo, hi;     /* neighbours whose planes this thread reads, -1 for none */
+} slab_sync_t;
+
+/* allocate zeroed counters and find the neighbours of a block.  Collective. */
+static void slab_sync_init(slab_sync_t *q, const slab_buf_t *b){
+
+  q->done = (strict shared int *)upc_all_alloc(THREADS, sizeof(int));
+  q->got = (strict shared int *)upc_all_alloc(THREADS, sizeof(int));
+  q->done[MYTHREAD] = 0;
+  q->got[MYTHREAD] = 0;
+  q->lo = (b->lo != NULL) ? (MYTHREAD + THREADS - 1) % THREADS : -1;
+  q->hi = (b->hi != NULL) ? (MYTHREAD + 1) % THREADS : -1;
+
+  upc_barrier;
+}
+
+static void slab_sync_free(slab_sync_t *q){
+
+  upc_barrier;
+
+  if (MYTHREAD == 0) {
+    upc_free((shared void *)q->done);
+    upc_free((shared void *)q->got);
+  }
+}
+
+/*
+ * Poll until both neighbours have counted up to at least value, yielding
+ * the processor in between in case threads outnumber the cores
+ */
+static void slab_sync_wait(const slab_sync_t *q, strict shared int *count, int value){
+
+  if (q->lo >= 0) while (count[q->lo] < value) sched_yield();
+  if (q->hi >= 0) while (count[q->hi] < value) sched_yield();
+}
+
+/*
+ * Fill the grid and run s->reps Jacobi iterations on it, sweeping through
+ * either private or shared pointers.  Returns the elapsed time; the time
+ * this thread spent in the halo exchange and synchronisation is added to
+ * *comm.
+ *
+ * With s->p2p set, the barrier at the end of every sweep is replaced by
+ * waits on the two neighbours alone: for them to finish sweep iter before
+ * their planes are fetched, and to have fetched this thread's planes of
+ * sweep iter-1 before the buffer holding them is overwritten.  A fast
+ * thread can then run up to a sweep ahead of its neighbours, and further
+ * ahead of the threads beyond them.
+ */
+static double slab_sweeps(const slab_t *s, slab_buf_t *a0, slab_buf_t *a1, int points, int via_shared, char *title, double *comm){
+
+  int iter;
+  double fac = stencil_fac(points);
+  double checksum, t_setup;
+  slab_buf_t tmp;
+  slab_sync_t sync;
+
+  struct timespec start, end, c0, c1;
+
+  t_setup = slab_fill(s, a0, a1);
+
+  if (s->p2p) slab_sync_init(&sync, a0);
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (iter = 0; iter < s->reps; iter++) {
+
+    clock_gettime(CLOCK, &c0);
+    if (s->p2p) slab_sync_wait(&sync, sync.done, iter);
+    slab_exchange(s, a0);
+    if (s->p2p) {
+      sync.got[MYTHREAD] = iter + 1;
+      slab_sync_wait(&sync, sync.got, iter);
+    }
+    clock_gettime(CLOCK, &c1);
+    *comm += elapsed_seconds(c0, c1);
+
+    if (via_shared) slab_sweep_shared(s, points, a1->own, a0->own, s->ghost, s->ghost + s->nloc, fac);
+    else slab_sweep_private(s, points, a1->mine, a0->mine, s->ghost, s->ghost + s->nloc, fac);
+
+    /* neighbours must have fetched our boundary planes before they change */
+    clock_gettime(CLOCK, &c0);
+    if (s->p2p) {
+      /* the sweep wrote through private pointers: make it visible first */
+      upc_fence;
+      sync.done[MYTHREAD] = iter + 1;
+    }
+    else upc_barrier;
+    clock_gettime(CLOCK, &c1);
+    *comm += elapsed_seconds(c0, c1);
+
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = *a0;
+    *a0 = *a1;
+    *a1 = tmp;
+
+  } /* end iteration loop */
+
+  /* without a barrier per sweep, the run is over only when every thread has finished */
+  if (s->p2p) upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  if (s->p2p) slab_sync_free(&sync);
+
+  checksum = slab_checksum(s, a0->mine);
+
+  if (MYTHREAD == 0){
+    elapsed_time_hr(start, end, title);
+    printf("Slab decomposition: %d-%d planes per thread, %lu bytes of halo per thread per iteration\n",
+	   slab_count(s, THREADS-1), slab_count(s, 0), (unsigned long)(2*s->ghost*s->plane*s->elem));
+    printf("Effective bandwidth: %.3lf GB/s\n", slab_bandwidth(s, elapsed_seconds(start, end)));
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  return elapsed_seconds(start, end);
+}
+
+/*
+ * 27/19-point stencil on a slab-decomposed 3D grid, or 9/5-point
+ * stencil on a 2D grid decomposed into blocks of rows
+ */
+void stencil_slab(unsigned int size, int points, bench_opts *opts){
+
+  slab_t s;
+  sk_type type;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (slab_init(&s, size, (points >= 19) ? 3 : 2, 1, 1, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: slab mode needs at least one interior plane per thread\n", points);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  if (!strcmp(opts->coef, "var")) {
+    if (points < 19 || opts->tol > 0.0) {
+      if (MYTHREAD == 0) printf("%d-point Stencil Error: variable coefficients are available for fixed count 27 and 19 point runs only\n", points);
+      return;
+    }
+    coef_bench(&s, points, opts);
+  }
+  else if (opts->tol > 0.0) {
+    if (strcmp(opts->sync, "barrier") != 0) {
+      if (MYTHREAD == 0) printf("%d-point Stencil Error: runs to a tolerance synchronise at their reductions, use --sync barrier\n", points);
+      return;
+    }
+    converge_bench(&s, points, opts);
+  }
+  else slab_bench(&s, points, opts);
+}
+
+/* report the time the threads spent in the halo exchange and waiting, collective */
+static void report_comm(double comm){
+
+  double mean = thread_mean(comm);
+  double max = thread_max(comm);
+
+  if (MYTHREAD == 0) printf("Exchange and wait: %.9lf s mean, %.9lf s max over the threads\n", mean, max);
+}
+
+/*
+ * Private sweeps with a barrier at the end of each, then with the
+ * neighbours synchronising point to point, reporting the time the
+ * threads spent exchanging and waiting
+ */
+static void sync_compare(slab_t *s, slab_buf_t *a0, slab_buf_t *a1, int points){
+
+  int p2p;
+  double seconds[2], comm[2], max[2];
+  char title[80];
+
+  for (p2p = 0; p2p < 2; p2p++) {
+    s->p2p = p2p;
+    comm[p2p] = 0.0;
+    sprintf(title, "Stencil - %s (slab, %s)", slab_label(s, points), p2p ? "point-to-point sync" : "barrier sync");
+    seconds[p2p] = slab_sweeps(s, a0, a1, points, 0, title, &comm[p2p]);
+    max[p2p] = thread_max(comm[p2p]);
+    comm[p2p] = thread_mean(comm[p2p]);
+  }
+  s->p2p = 0;
+
+  if (MYTHREAD == 0) {
+    printf("\n--- Stencil - %s (slab)\n", slab_label(s, points));
+    printf("--- Synchronisation -----------------------------------------------------------------\n");
+    printf("|\n");
+    for (p2p = 0; p2p < 2; p2p++) {
+      printf("| %-15s Duration: %.9lf s   Exchange and wait: %.9lf s mean, %.9lf s max\n",
+	     p2p ? "Point-to-point:" : "Barrier:", seconds[p2p], comm[p2p], max[p2p]);
+    }
+    printf("| Speedup: %.3lf\n", seconds[0] / seconds[1]);
+    printf("|\n");
+    printf("------------------------------------------------------------------------------------\n");
+  }
+}
+
+/* run the slab sweeps on a decomposition, for every tile configuration asked for */
+static void slab_bench(slab_t *s, int points, bench_opts *opts){
+
+  int c, ntile;
+  int tj[MAX_TILES], tk[MAX_TILES];
+  double t_shared = 0.0, t_private = 0.0, t_comm = 0.0;
+  double t_tile[MAX_TILES];
+  char title[80], tiles[40];
+
+  slab_buf_t a0, a1;
+
+  if ((ntile = slab_tiles(opts->tile, tj, tk, MAX_TILES)) < 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: tiles must be given as TJxTK[,TJxTK...], at most %d of them\n", points, MAX_TILES);
+    return;
+  }
+
+  /* Work buffers, with ghost planes */
+  if (slab_alloc_pair(s, &a0, &a1) != 0) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  for (c = 0; c < ntile; c++) {
+
+    s->tj = tj[c];
+    s->tk = tk[c];
+
+    if (s->dims == 3 && (s->tj > 0 || s->tk > 0)) sprintf(tiles, ", %dx%d tiles", s->tj, s->tk);
+    else tiles[0] = '\0';
+
+    if (RUN_SHARED(opts)) {
+      sprintf(title, "Stencil - %s (slab%s, shared pointers)", slab_label(s, points), tiles);
+      t_comm = 0.0;
+      t_shared = slab_sweeps(s, &a0, &a1, points, 1, title, &t_comm);
+      report_comm(t_comm);
+    }
+
+    if (RUN_PRIVATE(opts)) {
+      sprintf(title, "Stencil - %s (slab%s)", slab_label(s, points), tiles);
+      t_comm = 0.0;
+      t_private = slab_sweeps(s, &a0, &a1, points, 0, title, &t_comm);
+      report_comm(t_comm);
+    }
+
+    if (MYTHREAD == 0 && RUN_BOTH(opts)) {
+      sprintf(title, "Stencil - %s (slab%s)", slab_label(s, points), tiles);
+      variant_summary(title, t_shared, t_private);
+    }
+
+    t_tile[c] = RUN_PRIVATE(opts) ? t_private : t_shared;
+  }
+
+  if (strcmp(opts->sync, "both") == 0) sync_compare(s, &a0, &a1, points);
+
+  if (MYTHREAD == 0 && ntile > 1) {
+    printf("\n--- Stencil - %s (slab)\n", slab_label(s, points));
+    printf("--- Tile sizes ----------------------------------------------------------------------\n");
+    printf("|\n");
+    for (c = 0; c < ntile; c++) {
+      if (tj[c] > 0 || tk[c] > 0) sprintf(tiles, "%dx%d", tj[c], tk[c]);
+      else sprintf(tiles, "whole planes");
+      printf("| Tiles: %-14s Duration: %.9lf s   Bandwidth: %.3lf GB/s\n", tiles, t_tile[c], slab_bandwidth(s, t_tile[c]));
+    }
+    printf("|\n");
+    printf("------------------------------------------------------------------------------------\n");
+  }
+
+  /* Free memory to prevent leaks */
+  slab_free(&a0);
+  slab_free(&a1);
+
+}
+
+/*
+ * Temporally blocked 27- or 19-point stencil on a slab-decomposed grid.
+ *
+ * Every pass fetches tblock ghost planes from each neighbour and then
+ * advances tblock time steps without communicating, recomputing the
+ * shrinking ghost region redundantly.  Inside a pass the planes are
+ * processed in tiles of tdepth planes, each tile being carried through
+ * all the time steps of the pass while it is still in cache.  The tiles
+ * are skewed back by one plane per time step so that every plane a tile
+ * reads at step t-1 has already been produced, and so that a plane is
+ * only overwritten at step t once its value from step t-2 is no longer
+ * needed.
+ */
+void stencil_temporal(unsigned int size, int points, bench_opts *opts){
+
+  int tblock = opts->tblock;
+  int tdepth = opts->tdepth;
+
+  slab_t s;
+  sk_type type;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (tblock < 1 || tdepth < 1) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: tblock and tdepth must be positive\n", points);
+    return;
+  }
+
+  if (slab_init(&s, size, 3, 1, tblock, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: temporal mode needs at least tblock (%d) interior planes per thread\n", points, tblock);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  if (s.bc != SK_FIXED) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: temporal mode supports the fixed boundary only\n", points);
+    return;
+  }
+
+  temporal_bench(&s, points, opts);
+}
+
+/*
+ * Run the temporally blocked sweeps on a decomposition with r*tblock
+ * ghost planes on either side, where r is the radius of the stencil
+ */
+static void temporal_bench(slab_t *s, int points, bench_opts *opts){
+
+  int t, steps, done;
+  int tblock = opts->tblock;
+  int tdepth = opts->tdepth;
+  int r = s->star ? s->star : 1;
+  int edge, lo, hi, plo, phi, tile, last;
+  int dom_lo, dom_hi;
+  double fac = stencil_fac(points);
+  double checksum, t_setup;
+  void *buf[2];
+  char title[80];
+
+  slab_buf_t a0, a1, tmp;
+
+  struct timespec start, end;
+
+  /* Work buffers, with r*tblock ghost planes on either side */
+  if (slab_alloc_pair(s, &a0, &a1) != 0) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  t_setup = slab_fill(s, &a0, &a1);
+
+  /* local planes holding the global interior: the others are fixed halo */
+  dom_lo = s->ghost + s->halo - s->i0;
+  dom_hi = s->ghost + s->halo + s->n - s->i0;
+
+  /* planes past this one always fall into the last tile */
+  edge = s->nloc + 2*s->ghost;
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (done = 0; done < s->reps; done += steps) {
+
+    steps = (s->reps - done < tblock) ? s->reps - done : tblock;
+
+    slab_exchange(s, &a0);
+
+    /* neighbours overwrite their source block from the second step on */
+    upc_notify;
+
+    buf[0] = a0.mine;
+    buf[1] = a1.mine;
+
+    for (tile = s->ghost, last = 0; !last; tile += tdepth) {
+
+      last = (tile + tdepth >= edge);
+
+      for (t = 1; t <= steps; t++) {
+
+	if (t == 2 && tile == s->ghost) upc_wait;
+
+	/* planes still valid after t steps, clipped to the interior */
+	lo = (t*r > dom_lo) ? t*r : dom_lo;
+	hi = (edge - t*r < dom_hi) ? edge - t*r : dom_hi;
+
+	plo = (tile == s->ghost) ? lo : tile - t*r;
+	phi = last ? hi : tile + tdepth - t*r;
+	if (plo < lo) plo = lo;
+	if (phi > hi) phi = hi;
+	if (plo >= phi) continue;
+
+	slab_sweep_private(s, points, buf[t%2], buf[(t-1)%2], plo, phi, fac);
+      }
+    }
+
+    if (steps == 1) upc_wait;
+
+    /* neighbours must not fetch our boundary planes before they are final */
+    upc_barrier;
+
+    /* an odd number of steps leaves the result in the other buffer */
+    if (steps % 2) {
+      tmp = a0;
+      a0 = a1;
+      a1 = tmp;
+    }
+
+  } /* end iteration loop */
+
+  clock_gettime(CLOCK, &end);
+
+  checksum = slab_checksum(s, a0.mine);
+
+  if (MYTHREAD == 0){
+    sprintf(title, "Stencil - %s (temporal, %d steps x %d planes)", slab_label(s, points), tblock, tdepth);
+    elapsed_time_hr(start, end, title);
+    printf("Slab decomposition: %d-%d planes per thread, %lu bytes of halo per thread every %d iterations\n",
+	   slab_count(s, THREADS-1), slab_count(s, 0), (unsigned long)(2*s->ghost*s->plane*s->elem), tblock);
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  /* Free memory to prevent leaks */
+  slab_free(&a0);
+  slab_free(&a1);
+
+}
+
+/*
+ * 27/19/9/5-point stencil on a slab-decomposed grid with the halo
+ * exchange overlapped with computation.
+ *
+ * Neighbours only ever read the first and last owned plane of a block,
+ * so each iteration sweeps the inner planes while the ghost planes are
+ * in flight and finishes the two boundary planes once they have landed.
+ * The barrier is split: a thread notifies once its boundary planes are
+ * done, and only waits before the next exchange.  With the UPC 1.3
+ * non-blocking library the transfers overlap the inner sweep; without
+ * it the inner sweep is done before the wait, so it hides the barrier
+ * skew instead.
+ *
+ * The blocking slab sweep is run first on the same grid so the time
+ * spent communicating by both can be compared.
+ */
+void stencil_overlap(unsigned int size, int points, bench_opts *opts){
+
+  int iter;
+  int first, last;
+  double fac = stencil_fac(points);
+  double checksum, t_setup;
+  double t_block, t_overlap, c_block = 0.0, c_overlap = 0.0;
+  char title[80];
+
+  slab_t s;
+  slab_buf_t a0, a1, tmp;
+  sk_type type;
+
+  struct timespec start, end, c0, c1;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (slab_init(&s, size, (points >= 19) ? 3 : 2, 1, 1, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: overlap mode needs at least one interior plane per thread\n", points);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  /* Work buffers, with ghost planes */
+  if (slab_alloc_pair(&s, &a0, &a1) != 0) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  sprintf(title, "Stencil - %s (slab, blocking exchange)", slab_label(&s, points));
+  t_block = slab_sweeps(&s, &a0, &a1, points, 0, title, &c_block);
+
+  /* owned planes neighbours read from, and the inner planes between them */
+  first = s.ghost;
+  last = s.ghost + s.nloc - 1;
+
+  t_setup = slab_fill(&s, &a0, &a1);
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  upc_notify;
+
+  for (iter = 0; iter < s.reps; iter++) {
+
+#ifdef __UPC_NB__
+    /* neighbours have finished the planes we fetch, and their last fetch from us */
+    clock_gettime(CLOCK, &c0);
+    upc_wait;
+    slab_exchange_start(&s, &a0);
+    clock_gettime(CLOCK, &c1);
+    c_overlap += elapsed_seconds(c0, c1);
+
+    slab_sweep_private(&s, points, a1.mine, a0.mine, first+1, last, fac);
+
+    clock_gettime(CLOCK, &c0);
+    slab_exchange_end(&s, &a0);
+    clock_gettime(CLOCK, &c1);
+    c_overlap += elapsed_seconds(c0, c1);
+#else
+    /* the inner planes depend on nothing remote, and nobody reads them */
+    slab_sweep_private(&s, points, a1.mine, a0.mine, first+1, last, fac);
+
+    clock_gettime(CLOCK, &c0);
+    upc_wait;
+    slab_exchange_start(&s, &a0);
+    slab_exchange_end(&s, &a0);
+    clock_gettime(CLOCK, &c1);
+    c_overlap += elapsed_seconds(c0, c1);
+#endif
+
+    slab_sweep_private(&s, points, a1.mine, a0.mine, first, first+1, fac);
+    if (last > first) slab_sweep_private(&s, points, a1.mine, a0.mine, last, last+1, fac);
+
+    /* our boundary planes are final and our ghost planes are fetched */
+    upc_notify;
+
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = a0;
+    a0 = a1;
+    a1 = tmp;
+
+  } /* end iteration loop */
+
+  upc_wait;
+
+  clock_gettime(CLOCK, &end);
+
+  t_overlap = elapsed_seconds(start, end);
+
+  checksum = slab_checksum(&s, a0.mine);
+
+  c_block = thread_mean(c_block);
+  c_overlap = thread_mean(c_overlap);
+
+  if (MYTHREAD == 0){
+    sprintf(title, "Stencil - %s (slab, overlapped exchange)", slab_label(&s, points));
+    elapsed_time_hr(start, end, title);
+#ifdef __UPC_NB__
+    printf("Ghost planes fetched with upc_memget_nb\n");
+#else
+    printf("Ghost planes fetched with upc_memget (no UPC 1.3 non-blocking library)\n");
+#endif
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+
+    printf("\n--- Stencil - %s (slab)\n", slab_label(&s, points));
+    printf("--- Halo exchange overlap -----------------------------------------------------------\n");
+    printf("|\n");
+    printf("| Blocking: %.9lf s   Overlapped: %.9lf s   Speedup: %.3lf\n", t_block, t_overlap, t_block / t_overlap);
+    printf("| Exposed communication per thread: blocking %.9lf s, overlapped %.9lf s\n", c_block, c_overlap);
+    printf("| Communication hidden: %.1lf%%\n", (c_block > 0.0 && c_overlap < c_block) ? 100.0 * (1.0 - c_overlap / c_block) : 0.0);
+    printf("|\n");
+    printf("------------------------------------------------------------------------------------\n");
+  }
+
+  /* Free memory to prevent leaks */
+  slab_free(&a0);
+  slab_free(&a1);
+
+}
+
+/*
+ * High-order star stencils (2r+1 points per axis) in 2 or 3 dimensions.
+ *
+ * The fixed halo and the ghost region are r planes deep.  In temporal
+ * mode the ghost region is r*tblock planes, so one exchange covers tblock
+ * steps of the wide stencil.
+ */
+void stencil_star(unsigned int size, int dims, bench_opts *opts){
+
+  int r = opts->radius;
+  int points = 2*dims*r + 1;
+  int temporal = !strcmp(opts->mode, "temporal");
+  int ghost = r;
+
+  slab_t s;
+  sk_type type;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("Star Stencil Error: no %s stencil, use int, float or double\n", opts->dtype);
+    return;
+  }
+
+  if (r < 1 || r > SK_MAX_RADIUS) {
+    if (MYTHREAD == 0) printf("Star Stencil Error: radius must be between 1 and %d\n", SK_MAX_RADIUS);
+    return;
+  }
+
+  if (temporal) {
+    if (opts->tblock < 1 || opts->tdepth < 1) {
+      if (MYTHREAD == 0) printf("Star Stencil Error: tblock and tdepth must be positive\n");
+      return;
+    }
+    ghost = r * opts->tblock;
+  }
+
+  if (slab_init(&s, size, dims, r, ghost, type) != 0) {
+    if (MYTHREAD == 0) printf("Star Stencil Error: needs at least %d interior planes per thread\n", ghost);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  if (opts->tol > 0.0) {
+    if (MYTHREAD == 0) printf("Star Stencil Error: --tol runs support the 27, 19, 9 and 5 point stencils only\n");
+    return;
+  }
+
+  if (temporal && s.bc != SK_FIXED) {
+    if (MYTHREAD == 0) printf("Star Stencil Error: temporal mode supports the fixed boundary only\n");
+    return;
+  }
+
+  star_weights(&s, r);
+
+  if (temporal) temporal_bench(&s, points, opts);
+  else if (!strcmp(opts->mode, "stream")) stream_bench(&s, points, opts);
+  else slab_bench(&s, points, opts);
+}
+
+/*
+ * Streaming sweeps over a single grid.
+ *
+ * Each new plane is written to a small private ring of planes rather
+ * than to a second grid.  It is copied back over the old plane r planes
+ * later, once no other output plane needs the old value (r is the radius
+ * of the stencil).  A thread then holds one block of the grid plus 2r+1
+ * ring planes, instead of two blocks.  The stores of a sweep land in the
+ * ring, which stays in cache.
+ */
+static double stream_sweeps(const slab_t *s, slab_buf_t *a, char *ring, int points, char *title, double *comm){
+
+  int iter, p, q;
+  int r = s->star ? s->star : 1;
+  int slots = r + 1;
+  int first = s->ghost, last = s->ghost + s->nloc;
+  size_t bytes = s->plane * s->elem;
+  double fac = stencil_fac(points);
+  double checksum, t_setup, resident, twogrid;
+  char *grid = a->mine;
+
+  struct timespec start, end, c0, c1;
+
+  t_setup = slab_fill(s, a, NULL);
+
+  /* plane p is written to ring slot p % slots, r planes into the ring */
+  memset(ring, 0, (slots + r)*bytes);
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (iter = 0; iter < s->reps; iter++) {
+
+    clock_gettime(CLOCK, &c0);
+    slab_exchange(s, a);
+    /* neighbours must have fetched our boundary planes before they are overwritten */
+    upc_barrier;
+    clock_gettime(CLOCK, &c1);
+    *comm += elapsed_seconds(c0, c1);
+
+    for (p = first; p < last; p++) {
+      slab_sweep_private(s, points, ring + (p % slots)*bytes, grid + (p - r)*bytes, r, r + 1, fac);
+      q = p - r;
+      if (q >= first) memcpy(grid + q*bytes, ring + (q % slots + r)*bytes, bytes);
+    }
+
+    for (q = (last - r > first) ? last - r : first; q < last; q++) {
+      memcpy(grid + q*bytes, ring + (q % slots + r)*bytes, bytes);
+    }
+
+    /* and must not fetch them again until the sweep is complete */
+    clock_gettime(CLOCK, &c0);
+    upc_barrier;
+    clock_gettime(CLOCK, &c1);
+    *comm += elapsed_seconds(c0, c1);
+
+  } /* end iteration loop */
+
+  clock_gettime(CLOCK, &end);
+
+  checksum = slab_checksum(s, a->mine);
+
+  if (MYTHREAD == 0){
+    resident = ((s->nloc + 2*s->ghost) + (slots + r)) * (double)bytes;
+    twogrid = 2 * (s->nloc + 2*s->ghost) * (double)bytes;
+    elapsed_time_hr(start, end, title);
+    printf("Resident grid memory: %.3lf MB per thread (%.3lf MB with two grids)\n", resident/1.0e6, twogrid/1.0e6);
+    printf("Effective bandwidth: %.3lf GB/s\n", slab_bandwidth(s, elapsed_seconds(start, end)));
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  return elapsed_seconds(start, end);
+}
+
+/* run the streaming sweeps on a decomposition */
+static void stream_bench(slab_t *s, int points, bench_opts *opts){
+
+  int r = s->star ? s->star : 1;
+  double t_comm = 0.0;
+  char title[80];
+  char *ring;
+  int fail;
+
+  slab_buf_t a;
+
+  /* One grid, with ghost planes, and the ring of output planes */
+  ring = malloc((2*r + 1) * s->plane * s->elem);
+  fail = (slab_alloc(s, &a) != 0);
+  if (fail || any_thread(ring == NULL)) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    if (!fail) slab_free(&a);
+    free(ring);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  sprintf(title, "Stencil - %s (stream, %d plane ring)", slab_label(s, points), 2*r + 1);
+  stream_sweeps(s, &a, ring, points, title, &t_comm);
+
+  t_comm = thread_max(t_comm);
+  if (MYTHREAD == 0) printf("Halo exchange: %.9lf s (largest over the threads)\n", t_comm);
+
+  /* Free memory to prevent leaks */
+  slab_free(&a);
+  free(ring);
+
+}
+
+/*
+ * Stencil with a single resident grid: the slab layout, updated in place
+ * through a ring of output planes.  Only the private kernels are used.
+ */
+void stencil_stream(unsigned int size, int points, bench_opts *opts){
+
+  slab_t s;
+  sk_type type;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (slab_init(&s, size, (points >= 19) ? 3 : 2, 1, 1, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: stream mode needs at least one interior plane per thread\n", points);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  stream_bench(&s, points, opts);
+}
+
+/*
+ * Interior rows of a plane, and the offset in the plane of the first
+ * interior point of row j.  The in-plane halo around them is not
+ * updated by a sweep.
+ */
+static int slab_rows(const slab_t *s){
+  return (s->dims == 3) ? s->n : 1;
+}
+
+static size_t slab_row(const slab_t *s, int j){
+  return (s->dims == 3) ? (size_t)(s->halo + j)*s->size + s->halo : (size_t)s->halo;
+}
+
+/*
+ * 2-norm of the residual fac * (sum of the neighbours) - u over the
+ * interior of a slab grid, returned on thread 0.  Each plane of the
+ * Jacobi update is computed into the second plane of a two plane
+ * scratch buffer, so no second grid is needed.  The ghost planes are
+ * refreshed first.
+ */
+static double slab_residual(const slab_t *s, slab_buf_t *a, char *scratch, int points){
+
+  int p, j, k;
+  size_t e;
+  size_t bytes = s->plane * s->elem;
+  double d, sum = 0.0;
+  double fac = stencil_fac(points);
+  char *grid = a->mine;
+
+  slab_exchange(s, a);
+  upc_barrier;
+
+  memset(scratch, 0, 2*bytes);
+
+  for (p = s->ghost; p < s->ghost + s->nloc; p++) {
+    slab_sweep_private(s, points, scratch, grid + (p - 1)*bytes, 1, 2, fac);
+    for (j = 0; j < slab_rows(s); j++) {
+      e = slab_row(s, j);
+      for (k = 0; k < s->n; k++, e++) {
+	d = sk_get(s->type, scratch, s->plane + e) - sk_get(s->type, grid, p*s->plane + e);
+	sum += d*d;
+      }
+    }
+  }
+
+  return sqrt(thread_mean(sum) * THREADS);
+}
+
+/* residual reduction per sweep, from the residuals before and after n sweeps */
+static double sweep_rate(double r0, double r1, int n){
+  return (r0 > 0.0 && n > 0) ? pow(r1 / r0, 1.0 / n) : 0.0;
+}
+
+/* report the convergence of a run, with the time it takes to gain a digit */
+static void report_rate(const char *name, double rate, double seconds, int n){
+
+  if (rate > 0.0 && rate < 1.0) {
+    printf("%-13s residual reduction per sweep: %.9lf, time per decade: %.9lf s\n",
+	   name, rate, seconds / n * log(0.1) / log(rate));
+  }
+  else printf("%-13s residual reduction per sweep: %.9lf\n", name, rate);
+}
+
+/*
+ * Multicolour Gauss-Seidel sweeps over a single grid, updated in place.
+ *
+ * A sweep visits the colours in turn.  Each colour refreshes the ghost
+ * planes, updates its points and ends with a barrier, after which
+ * neighbours may read the new values.  A neighbour can fetch a boundary
+ * plane while its owner is updating the next colour, but that colour is
+ * not used by the points that read the plane.
+ */
+static double gs_sweeps(const slab_t *s, slab_buf_t *a, char *scratch, int points, int via_shared, char *title, double *rate){
+
+  int iter, c;
+  int colours = (points >= 19) ? 8 : (points == 9) ? 4 : 2;
+  double fac = stencil_fac(points);
+  double checksum, t_setup, r0, r1, seconds;
+
+  struct timespec start, end;
+
+  t_setup = slab_fill(s, a, NULL);
+  r0 = slab_residual(s, a, scratch, points);
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (iter = 0; iter < s->reps; iter++) {
+    for (c = 0; c < colours; c++) {
+      slab_exchange(s, a);
+      slab_colour(s, points, a, via_shared, c, fac);
+      upc_barrier;
+    }
+  } /* end iteration loop */
+
+  clock_gettime(CLOCK, &end);
+
+  seconds = elapsed_seconds(start, end);
+  r1 = slab_residual(s, a, scratch, points);
+  *rate = sweep_rate(r0, r1, s->reps);
+
+  checksum = slab_checksum(s, a->mine);
+
+  if (MYTHREAD == 0){
+    elapsed_time_hr(start, end, title);
+    printf("Colours: %d, one barrier per colour\n", colours);
+    printf("Updates: %.3lf Mupdates/s\n", pow(s->n, s->dims) * s->reps / seconds / 1.0e6);
+    report_rate("Gauss-Seidel", *rate, seconds, s->reps);
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  return seconds;
+}
+
+/*
+ * In-place Gauss-Seidel on the slab layout, with a single grid.  The
+ * Jacobi slab sweep is run afterwards on a second grid, so the two can be
+ * compared on time to solution rather than time per sweep.
+ */
+void stencil_gs(unsigned int size, int points, bench_opts *opts){
+
+  double t_shared = 0.0, t_private = 0.0, t_jacobi, t_comm = 0.0;
+  double rate = 0.0, r0, r1;
+  char title[80];
+  char *scratch;
+  int fail;
+
+  slab_t s;
+  slab_buf_t a0, a1;
+  sk_type type;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (slab_init(&s, size, (points >= 19) ? 3 : 2, 1, 1, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: gs mode needs at least one interior plane per thread\n", points);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  /* the colours only match up across a periodic boundary on an even grid */
+  if (s.bc == SK_PERIODIC && s.n % 2 != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: periodic gs mode needs an even number of interior points\n", points);
+    return;
+  }
+
+  /* One grid, with ghost planes, and two planes of scratch for the residual */
+  scratch = malloc(2 * s.plane * s.elem);
+  fail = (slab_alloc(&s, &a0) != 0);
+  if (fail || any_thread(scratch == NULL)) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    if (!fail) slab_free(&a0);
+    free(scratch);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  if (RUN_SHARED(opts)) {
+    sprintf(title, "Stencil - %s (gauss-seidel, shared pointers)", slab_label(&s, points));
+    t_shared = gs_sweeps(&s, &a0, scratch, points, 1, title, &rate);
+  }
+
+  if (RUN_PRIVATE(opts)) {
+    sprintf(title, "Stencil - %s (gauss-seidel)", slab_label(&s, points));
+    t_private = gs_sweeps(&s, &a0, scratch, points, 0, title, &rate);
+  }
+
+  if (MYTHREAD == 0 && RUN_BOTH(opts)) {
+    sprintf(title, "Stencil - %s (gauss-seidel)", slab_label(&s, points));
+    variant_summary(title, t_shared, t_private);
+  }
+
+  /* Jacobi reference, which needs the second grid */
+  if (slab_alloc(&s, &a1) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    slab_free(&a0);
+    free(scratch);
+    return;
+  }
+
+  slab_fill(&s, &a0, &a1);
+  r0 = slab_residual(&s, &a0, scratch, points);
+
+  sprintf(title, "Stencil - %s (slab, jacobi)", slab_label(&s, points));
+  t_jacobi = slab_sweeps(&s, &a0, &a1, points, 0, title, &t_comm);
+
+  r1 = slab_residual(&s, &a0, scratch, points);
+
+  if (MYTHREAD == 0) {
+    printf("\n--- Stencil - %s (gauss-seidel vs jacobi)\n", slab_label(&s, points));
+    report_rate("Jacobi", sweep_rate(r0, r1, s.reps), t_jacobi, s.reps);
+    report_rate("Gauss-Seidel", rate, RUN_PRIVATE(opts) ? t_private : t_shared, s.reps);
+  }
+
+  /* Free memory to prevent leaks */
+  slab_free(&a0);
+  slab_free(&a1);
+  free(scratch);
+
+}
+
+/*
+ * Sum of the squared changes over the interior points of the owned
+ * planes of a slab grid, the points sk_sweep accumulates, as a pass of
+ * its own
+ */
+static double slab_change(const slab_t *s, const void *new, const void *old){
+
+  int p, j;
+  size_t e, lo, hi;
+  double d, sum = 0.0;
+
+  for (p = s->ghost; p < s->ghost + s->nloc; p++) {
+    for (j = 0; j < slab_rows(s); j++) {
+
+      lo = p*s->plane + slab_row(s, j);
+      hi = lo + s->n;
+
+      switch (s->type) {
+      case SK_INT: {
+	const int *x = new, *y = old;
+	for (e = lo; e < hi; e++) { d = (double)x[e] - y[e]; sum += d*d; }
+	break;
+      }
+      case SK_FLOAT: {
+	const float *x = new, *y = old;
+	for (e = lo; e < hi; e++) { d = (double)x[e] - y[e]; sum += d*d; }
+	break;
+      }
+      default: {
+	const double *x = new, *y = old;
+	for (e = lo; e < hi; e++) { d = x[e] - y[e]; sum += d*d; }
+	break;
+      }
+      }
+    }
+  }
+
+  return sum;
+}
+
+/*
+ * Sum of a value over all threads, returned on every thread in the same
+ * order.  Successive calls alternate between the two arrays in part, so
+ * a thread can write its next value while others still read the last
+ * one, and a single barrier per call is enough.
+ */
+static double thread_sum(shared double *part[2], int call, double value){
+
+  int t;
+  double sum = 0.0;
+  shared double *p = part[call & 1];
+
+  p[MYTHREAD] = value;
+
+  upc_barrier;
+
+  for (t = 0; t < THREADS; t++) sum += p[t];
+
+  return sum;
+}
+
+/*
+ * Jacobi sweeps until the 2-norm of the change of the grid (the Jacobi
+ * residual) drops below tol times its value after the first sweep, or
+ * maxiter sweeps have been done.  The residual is summed locally and
+ * reduced across threads every rcheck sweeps, either in the same pass as
+ * the update (fused) or in a pass of its own.  The reduction stands in
+ * for the barrier of the sweeps it is done on.
+ */
+static double converge_sweeps(const slab_t *s, slab_buf_t *a0, slab_buf_t *a1, int points, bench_opts *opts, int fused, shared double *part[2], char *title, int *iters){
+
+  int iter, check, calls = 0, done = 0;
+  double fac = stencil_fac(points);
+  double checksum, t_setup, local, r0 = 0.0, res = 0.0;
+  double t_comm = 0.0, t_reduce = 0.0, t_resid = 0.0, seconds;
+  slab_buf_t tmp;
+
+  struct timespec start, end, c0, c1;
+
+  t_setup = slab_fill(s, a0, a1);
+
+  /* run main computation */
+  clock_gettime(CLOCK, &start);
+
+  for (iter = 0; iter < opts->maxiter && !done; iter++) {
+
+    clock_gettime(CLOCK, &c0);
+    slab_exchange(s, a0);
+    clock_gettime(CLOCK, &c1);
+    t_comm += elapsed_seconds(c0, c1);
+
+    check = (iter == 0 || (iter + 1) % opts->rcheck == 0 || iter + 1 == opts->maxiter);
+    local = 0.0;
+
+    if (check && fused) {
+      sk_sweep(s->type, points, a1->mine, a0->mine, s->size, s->size, s->ghost, s->ghost + s->nloc, s->tj, s->tk, fac, &local);
+    }
+    else {
+      slab_sweep_private(s, points, a1->mine, a0->mine, s->ghost, s->ghost + s->nloc, fac);
+    }
+
+    if (check && !fused) {
+      clock_gettime(CLOCK, &c0);
+      local = slab_change(s, a1->mine, a0->mine);
+      clock_gettime(CLOCK, &c1);
+      t_resid += elapsed_seconds(c0, c1);
+    }
+
+    clock_gettime(CLOCK, &c0);
+    if (check) {
+      res = sqrt(thread_sum(part, calls++, local));
+      if (iter == 0) r0 = res;
+      if (res <= opts->tol * r0) done = 1;
+    }
+    else {
+      /* neighbours must have fetched our boundary planes before they change */
+      upc_barrier;
+    }
+    clock_gettime(CLOCK, &c1);
+    if (check) t_reduce += elapsed_seconds(c0, c1);
+    else t_comm += elapsed_seconds(c0, c1);
+
+    /* swap buffers: this iteration's output is the next one's input */
+    tmp = *a0;
+    *a0 = *a1;
+    *a1 = tmp;
+
+  } /* end iteration loop */
+
+  clock_gettime(CLOCK, &end);
+
+  seconds = elapsed_seconds(start, end);
+  *iters = iter;
+
+  checksum = slab_checksum(s, a0->mine);
+
+  if (MYTHREAD == 0){
+    elapsed_time_hr(start, end, title);
+    printf("Iterations: %d, %s (tolerance %.3e, at most %d)\n", iter, done ? "converged" : "not converged", opts->tol, opts->maxiter);
+    printf("Residual: %.9e, %.3e of the first\n", res, (r0 > 0.0) ? res / r0 : 0.0);
+    printf("Residual reductions: %d, every %d iterations, %s\n", calls, opts->rcheck, fused ? "fused with the sweep" : "in a pass of their own");
+    printf("Time per iteration: %.9lf s\n", seconds / iter);
+    if (!fused) printf("Residual passes: %.9lf s\n", t_resid);
+    printf("Global reductions: %.9lf s, halo exchange: %.9lf s\n", t_reduce, t_comm);
+    printf("Grid setup: %.9lf s\n", t_setup);
+    printf("Grid checksum: %.15e\n", checksum);
+  }
+
+  return seconds;
+}
+
+/* run to a tolerance, with the residual fused into the sweep and then in a pass of its own */
+static void converge_bench(slab_t *s, int points, bench_opts *opts){
+
+  int it_fused, it_separate;
+  double t_fused, t_separate;
+  char title[80];
+  shared double *part[2];
+
+  slab_buf_t a0, a1;
+
+  if (opts->rcheck < 1 || opts->maxiter < 1) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: rcheck and maxiter must be positive\n", points);
+    return;
+  }
+
+  /* Work buffers, with ghost planes */
+  if (slab_alloc_pair(s, &a0, &a1) != 0) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    return;
+  }
+
+  part[0] = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+  part[1] = (shared double *)upc_all_alloc(THREADS, sizeof(double));
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  sprintf(title, "Stencil - %s (slab, to tolerance, fused residual)", slab_label(s, points));
+  t_fused = converge_sweeps(s, &a0, &a1, points, opts, 1, part, title, &it_fused);
+
+  sprintf(title, "Stencil - %s (slab, to tolerance, separate residual)", slab_label(s, points));
+  t_separate = converge_sweeps(s, &a0, &a1, points, opts, 0, part, title, &it_separate);
+
+  if (MYTHREAD == 0) {
+    printf("\n--- Stencil - %s (slab, to tolerance)\n", slab_label(s, points));
+    printf("Fused residual: %.9lf s per iteration\n", t_fused / it_fused);
+    printf("Separate residual: %.9lf s per iteration\n", t_separate / it_separate);
+    printf("Saving of fusion: %.1lf%%\n", 100.0 * (1.0 - (t_fused / it_fused) / (t_separate / it_separate)));
+  }
+
+  /* Free memory to prevent leaks */
+  upc_barrier;
+  if (MYTHREAD == 0) {
+    upc_free(part[0]);
+    upc_free(part[1]);
+  }
+  slab_free(&a0);
+  slab_free(&a1);
+
+}
+
+/*
+ * Allocate and fill the per-point coefficients of the variable
+ * coefficient 27 and 19 point stencils: one block per class of
+ * neighbour (faces, edges and, for 27 points, corners), with the layout
+ * and affinity of the grid blocks.  The coefficients of a point are
+ * keyed on its global index, positive, and weight its neighbours to a
+ * total of one.  Returns the setup time, or a negative value if the
+ * allocation failed.
+ */
+static double slab_coef(slab_t *s, int points, slab_buf_t coef[3]){
+
+  static const int members[3] = { 6, 12, 8 };
+  int c, i, j, k;
+  double u[3], norm;
+  unsigned long long g, total = (unsigned long long)s->size*s->size*s->size;
+  slab_t cs = *s;
+  size_t e;
+
+  struct timespec start, end;
+
+  /* the coefficient blocks have their own element size */
+  cs.type = slab_coef_type(s);
+  cs.elem = sk_type_size(cs.type);
+
+  s->ncoef = (points == 27) ? 3 : 2;
+
+  for (c = 0; c < s->ncoef; c++) {
+    if (slab_alloc(&cs, &coef[c]) != 0) {
+      while (c-- > 0) slab_free(&coef[c]);
+      s->ncoef = 0;
+      return -1.0;
+    }
+  }
+
+  clock_gettime(CLOCK, &start);
+
+  for (c = 0; c < s->ncoef; c++) memset(coef[c].mine, 0, (s->nloc + 2*s->ghost) * s->plane * cs.elem);
+
+  for (i = s->ghost; i < s->ghost + s->nloc; i++) {
+    for (j = s->halo; j < s->halo + s->n; j++) {
+      for (k = s->halo; k < s->halo + s->n; k++) {
+	g = (s->i0 + i - s->ghost) * s->plane + j*s->size + k;
+	e = i*s->plane + j*s->size + k;
+	norm = 0.0;
+	for (c = 0; c < s->ncoef; c++) {
+	  u[c] = 0.5 + counter_uniform(g + (c+1)*total);
+	  norm += members[c] * u[c];
+	}
+	for (c = 0; c < s->ncoef; c++) sk_set(cs.type, coef[c].mine, e, u[c] / norm);
+      }
+    }
+  }
+
+  upc_barrier;
+
+  clock_gettime(CLOCK, &end);
+
+  s->coef = coef;
+
+  return elapsed_seconds(start, end);
+}
+
+/* run the slab sweeps with a coefficient per point and neighbour class */
+static void coef_bench(slab_t *s, int points, bench_opts *opts){
+
+  int c;
+  double t_coef;
+  slab_buf_t coef[3];
+
+  if ((t_coef = slab_coef(s, points, coef)) < 0.0) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    return;
+  }
+
+  if (MYTHREAD == 0) {
+    printf("Coefficient setup: %.9lf s, %d arrays of %s\n", t_coef, s->ncoef, sk_type_name(slab_coef_type(s)));
+  }
+
+  slab_bench(s, points, opts);
+
+  /* Free memory to prevent leaks */
+  for (c = 0; c < s->ncoef; c++) slab_free(&coef[c]);
+  s->ncoef = 0;
+  s->coef = NULL;
+
+}
+
+/*
+ * Largest absolute and relative RMS deviation of the owned planes of a
+ * grid from a double reference copy of them, valid on thread 0
+ */
+static void slab_deviation(const slab_t *s, const void *mine, const double *ref, double *maxdev, double *rmsdev){
+
+  size_t e, owned = s->nloc * s->plane;
+  size_t base = s->ghost * s->plane;
+  double d, max = 0.0, sq = 0.0, norm = 0.0;
+
+  for (e = 0; e < owned; e++) {
+    d = fabs(sk_get(s->type, mine, base + e) - ref[e]);
+    if (d > max) max = d;
+    sq += d*d;
+    norm += ref[e]*ref[e];
+  }
+
+  *maxdev = thread_max(max);
+  sq = thread_mean(sq);
+  norm = thread_mean(norm);
+  *rmsdev = (norm > 0.0) ? sqrt(sq / norm) : 0.0;
+}
+
+/*
+ * Float storage with wider sums, against the double reference.
+ *
+ * The grid is swept in double first and the result kept as a reference.
+ * It is then swept with float storage three times: summing in float, in
+ * double, and in float with compensation.  The float runs move half the
+ * bytes of the double one through memory and the halo exchange.
+ */
+void stencil_mixed(unsigned int size, int points, bench_opts *opts){
+
+  static const sk_sum sums[4] = { SK_SUM_PLAIN, SK_SUM_PLAIN, SK_SUM_WIDE, SK_SUM_KAHAN };
+  int v;
+  double seconds[4], bw[4], maxdev[4], rmsdev[4];
+  double t_comm = 0.0;
+  double *ref;
+  char title[80];
+  char names[4][64];
+
+  slab_t s;
+  slab_buf_t a0, a1;
+
+  if (slab_init(&s, size, 3, 1, 1, SK_DOUBLE) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: mixed mode needs at least one interior plane per thread\n", points);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  /* Reference copy of the owned planes, private, so every thread must hear of a failure before any returns */
+  ref = malloc(s.nloc * s.plane * sizeof(double));
+  if (any_thread(ref == NULL)) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    free(ref);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  for (v = 0; v < 4; v++) {
+
+    s.type = (v == 0) ? SK_DOUBLE : SK_FLOAT;
+    s.elem = sk_type_size(s.type);
+    s.sum = sums[v];
+
+    /* Work buffers, with ghost planes */
+    if (slab_alloc_pair(&s, &a0, &a1) != 0) {
+      /* Something went wrong in the memory allocation here, fail gracefully */
+      if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+      free(ref);
+      return;
+    }
+
+    strcpy(names[v], slab_label(&s, points));
+    sprintf(title, "Stencil - %s (slab)", names[v]);
+    seconds[v] = slab_sweeps(&s, &a0, &a1, points, 0, title, &t_comm);
+    bw[v] = slab_bandwidth(&s, seconds[v]);
+
+    if (v == 0) memcpy(ref, (double *)a0.mine + s.ghost * s.plane, s.nloc * s.plane * sizeof(double));
+
+    slab_deviation(&s, a0.mine, ref, &maxdev[v], &rmsdev[v]);
+
+    /* Free memory to prevent leaks */
+    slab_free(&a0);
+    slab_free(&a1);
+  }
+
+  if (MYTHREAD == 0) {
+    printf("\n--- Stencil - %d point (slab, mixed precision)\n", points);
+    printf("--- Deviation from double after %d sweeps -------------------------------------------\n", s.reps);
+    printf("|\n");
+    for (v = 0; v < 4; v++) {
+      printf("| %-40s Duration: %.9lf s   Updates: %.3lf M/s   Bandwidth: %.3lf GB/s   Max deviation: %.3e   RMS deviation: %.3e\n",
+	     names[v], seconds[v], pow(s.n, s.dims) * s.reps / seconds[v] / 1.0e6, bw[v], maxdev[v], rmsdev[v]);
+    }
+    printf("|\n");
+    printf("------------------------------------------------------------------------------------\n");
+  }
+
+  free(ref);
+
+}
+
+/*
+ * The private slab sweep against one generated and compiled for this
+ * stencil, type, grid size and weight at run time.  The start-up cost of
+ * the specialised kernel is reported apart from its sweeps, with the
+ * number of sweeps after which it has paid for itself.
+ */
+void stencil_jit(unsigned int size, int points, bench_opts *opts){
+
+  slab_t s;
+  sk_type type;
+  sk_jit_t jit;
+  double t_generic, t_jit, t_comm = 0.0, startup, gain;
+  char title[80];
+
+  slab_buf_t a0, a1;
+
+  if (slab_type(opts->dtype, &type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: no %s stencil, use int, float or double\n", points, opts->dtype);
+    return;
+  }
+
+  if (slab_init(&s, size, (points >= 19) ? 3 : 2, 1, 1, type) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: jit mode needs at least one interior plane per thread\n", points);
+    return;
+  }
+
+  if (slab_options(&s, points, opts) != 0) return;
+
+  /* Work buffers, with ghost planes */
+  if (slab_alloc_pair(&s, &a0, &a1) != 0) {
+    /* Something went wrong in the memory allocation here, fail gracefully */
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: Unable to allocate memory\n", points);
+    return;
+  }
+
+  if (MYTHREAD == 0){
+    printf("Running with %d UPC thread(s):\n\n",THREADS);
+  }
+
+  sprintf(title, "Stencil - %s (slab)", slab_label(&s, points));
+  t_generic = slab_sweeps(&s, &a0, &a1, points, 0, title, &t_comm);
+
+  if (sk_jit_load(&jit, s.type, points, s.size, stencil_fac(points)) != 0) {
+    if (MYTHREAD == 0) printf("%d-point Stencil Error: unable to build or load %s, check SK_JIT_CC, SK_JIT_CFLAGS and SK_JIT_DIR\n", points, jit.path);
+    slab_free(&a0);
+    slab_free(&a1);
+    return;
+  }
+
+  s.jit = jit.sweep;
+
+  sprintf(title, "Stencil - %s (slab, specialised)", slab_label(&s, points));
+  t_jit = slab_sweeps(&s, &a0, &a1, points, 0, title, &t_comm);
+
+  if (MYTHREAD == 0) {
+    startup = jit.build + jit.load;
+    gain = (t_generic - t_jit) / s.reps;
+
+    printf("\n--- Stencil - %s (slab, specialised at run time)\n", slab_label(&s, points));
+    printf("--- Start-up and steady state -------------------------------------------------------\n");
+    printf("|\n");
+    printf("| Kernel: %s (%s)\n", jit.path, jit.cached ? "cached" : "built");
+    printf("| Start-up: %.6lf s   Generate and compile: %.6lf s   Load: %.6lf s\n", startup, jit.build, jit.load);
+    printf("| Generic: %.9lf s   Specialised: %.9lf s   Speedup: %.3lf\n", t_generic, t_jit, t_generic / t_jit);
+    if (gain > 0.0) printf("| Pays for itself after %.0lf sweep(s)\n", ceil(startup / gain));
+    else printf("| No faster than the generic sweep\n");
+    printf("|\n");
+    printf("------------------------------------------------------------------------------------\n");
+  }
+
+  sk_jit_close(&jit);
+
+  /* Free memory to prevent leaks */
+  slab_free(&a0);
+  slab_free(&a1);
+
+}
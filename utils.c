@@ -65,6 +65,87 @@ double elapsed_time_hr(struct timespec t1, struct timespec t2, char * title){
   return 1.0; // Compatibility
 }
 
+/* Duration between two timestamps in seconds */
+double elapsed_seconds(struct timespec t1, struct timespec t2){
+
+  struct timespec elapsed;
+  sub_time_hr(&elapsed, &t1, &t2);
+
+  return elapsed.tv_sec + ((double)elapsed.tv_nsec/1000000000);
+}
+
+/*
+ * SplitMix64 output function: a well mixed 64-bit value for any 64-bit
+ * counter, so random values can be generated independently for every
+ * index without sharing generator state between threads.
+ */
+unsigned long long splitmix64(unsigned long long x){
+
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+  return x ^ (x >> 31);
+}
+
+/* Uniform double in [0, 1) keyed on a counter */
+double counter_uniform(unsigned long long x){
+  return (splitmix64(x) >> 11) * (1.0/9007199254740992.0);
+}
+
+/* Report the shared-pointer and private-pointer timings of one kernel side by side */
+void variant_summary(char *title, double shared_time, double private_time){
+
+  printf("\n--- %s\n", title);
+  printf("--- Shared vs private access -------------------------------------------------------\n");
+  printf("|\n");
+  printf("| Shared: %.9lf s   ", shared_time);
+  printf("Private: %.9lf s   ", private_time);
+  printf("Shared/private: %.3lf\n", shared_time / private_time);
+  printf("|\n");
+  printf("------------------------------------------------------------------------------------\n");
+}
+
+/*
+ * Report a fused kernel against the separate kernels it replaces, with
+ * the bytes of memory traffic each moves
+ */
+void fused_summary(char *title, double separate_time, double fused_time, double separate_bytes, double fused_bytes){
+
+  printf("\n--- %s\n", title);
+  printf("--- Separate vs fused kernels ------------------------------------------------------\n");
+  printf("|\n");
+  printf("| Separate: %.9lf s   ", separate_time);
+  printf("Fused: %.9lf s   ", fused_time);
+  printf("Separate/fused: %.3lf\n", separate_time / fused_time);
+  printf("| Separate: %.3lf GB/s   ", separate_bytes / separate_time * 1.0e-9);
+  printf("Fused: %.3lf GB/s\n", fused_bytes / fused_time * 1.0e-9);
+  printf("| Traffic saved: %.3lf MB of %.3lf MB (%.1lf%%)\n", (separate_bytes - fused_bytes) * 1.0e-6, separate_bytes * 1.0e-6, 100.0 * (separate_bytes - fused_bytes) / separate_bytes);
+  printf("|\n");
+  printf("------------------------------------------------------------------------------------\n");
+}
+
+/*
+ * Split a reduction kernel's time into the local sweep, up to the barrier
+ * after it, and the combination of the per-thread partials
+ */
+void reduction_summary(struct timespec start, struct timespec mid, struct timespec end){
+
+  printf("Local sweep: %.9lf s   Reduction: %.9lf s\n", elapsed_seconds(start, mid), elapsed_seconds(mid, end));
+}
+
+/* Report the time taken to fill the inputs of a kernel, apart from the timed section */
+void setup_summary(struct timespec start, struct timespec end){
+
+  printf("Setup: %.9lf s\n", elapsed_seconds(start, end));
+}
+
+/* Report the rate of a kernel doing the given floating point operations and bytes of memory traffic */
+void rate_summary(double flops, double bytes, double seconds){
+
+  printf("GFLOP/s: %.3lf   GB/s: %.3lf   Bytes/flop: %.3lf\n", flops / seconds * 1.0e-9, bytes / seconds * 1.0e-9, bytes / flops);
+}
+
 void loop_timer(unsigned long limit){
 
   struct timespec t1, t2;
@@ -131,6 +212,30 @@ void upc_barrier_timer(){
   if (MYTHREAD == 0) elapsed_time_hr(t1, t2, "UPC barrier");
 }
 
+/* set by any thread that passes a set flag to any_thread */
+static shared int any_flag;
+
+/*
+ * Whether flag is set on any thread, returned on every thread, so that
+ * all of them take the same path after a private allocation failed on
+ * some.  Collective.
+ */
+int any_thread(int flag){
+
+  int any;
+
+  if (MYTHREAD == 0) any_flag = 0;
+  upc_barrier;
+
+  if (flag) any_flag = 1;
+  upc_barrier;
+
+  any = any_flag;
+  upc_barrier;
+
+  return any;
+}
+
 
 void interrupt_handler(int signum){
   stop = 1;
@@ -39,10 +39,19 @@ void clock_gettime (void*, struct timespec *);
 volatile sig_atomic_t stop;
 
 double elapsed_time_hr(struct timespec, struct timespec, char *);
+double elapsed_seconds(struct timespec, struct timespec);
+void variant_summary(char *, double, double);
+void fused_summary(char *, double, double, double, double);
+void reduction_summary(struct timespec, struct timespec, struct timespec);
+void setup_summary(struct timespec, struct timespec);
+void rate_summary(double, double, double);
+unsigned long long splitmix64(unsigned long long);
+double counter_uniform(unsigned long long);
 void loop_timer(unsigned long);
 void loop_timer_nop(unsigned long);
 void upc_loop_timer_nop(unsigned long);
 void upc_barrier_timer();
+int any_thread(int);
 void warmup_loop(unsigned long);
 void interrupt_handler(int);
 void discrete_elapsed_hr(struct timespec*, struct timespec*, int*, char*);